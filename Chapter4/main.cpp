@@ -1060,13 +1060,19 @@ private:
 
         XrMatrix4x4f_Multiply(&cameraConstants.modelViewProj, &cameraConstants.viewProj, &cameraConstants.model);
         cameraConstants.color = {color.x, color.y, color.z, 1.0};
-        size_t offsetCameraUB = sizeof(CameraConstants) * renderCuboidIndex;
 
         m_graphicsAPI->SetPipeline(m_pipeline);
 
-        m_graphicsAPI->SetBufferData(m_uniformBuffer_Camera, offsetCameraUB, sizeof(CameraConstants), &cameraConstants);
-        m_graphicsAPI->SetDescriptor({0, m_uniformBuffer_Camera, GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::VERTEX, false, offsetCameraUB, sizeof(CameraConstants)});
-        m_graphicsAPI->SetDescriptor({1, m_uniformBuffer_Normals, GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::VERTEX, false, 0, sizeof(normals)});
+        // Prefer the graphics API's transient uniform memory. Otherwise, fall back to our own buffer, indexed by renderCuboidIndex.
+        size_t offsetCameraUB = 0;
+        GraphicsAPI::BufferHandle uniformBufferCamera = m_graphicsAPI->AllocateUniformBufferData(sizeof(CameraConstants), &cameraConstants, offsetCameraUB);
+        if (!uniformBufferCamera) {
+            uniformBufferCamera = m_uniformBuffer_Camera;
+            offsetCameraUB = sizeof(CameraConstants) * renderCuboidIndex;
+            m_graphicsAPI->SetBufferData(m_uniformBuffer_Camera, offsetCameraUB, sizeof(CameraConstants), &cameraConstants);
+        }
+        m_graphicsAPI->SetDescriptor({0, uniformBufferCamera.ToPointer(), GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::VERTEX, false, offsetCameraUB, sizeof(CameraConstants)});
+        m_graphicsAPI->SetDescriptor({1, m_uniformBuffer_Normals.ToPointer(), GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::VERTEX, false, 0, sizeof(normals)});
 
         m_graphicsAPI->UpdateDescriptors();
 
@@ -1387,18 +1393,18 @@ private:
     float m_viewHeightM = 1.5f;
 
     // Vertex and index buffers: geometry for our cuboids.
-    void *m_vertexBuffer = nullptr;
-    void *m_indexBuffer = nullptr;
+    GraphicsAPI::BufferHandle m_vertexBuffer;
+    GraphicsAPI::BufferHandle m_indexBuffer;
     // Camera values constant buffer for the shaders.
-    void *m_uniformBuffer_Camera = nullptr;
+    GraphicsAPI::BufferHandle m_uniformBuffer_Camera;
     // The normals are stored in a uniform buffer to simplify our vertex geometry.
-    void *m_uniformBuffer_Normals = nullptr;
+    GraphicsAPI::BufferHandle m_uniformBuffer_Normals;
 
     // We use only two shaders in this app.
     void *m_vertexShader = nullptr, *m_fragmentShader = nullptr;
 
     // The pipeline is a graphics-API specific state object.
-    void *m_pipeline = nullptr;
+    GraphicsAPI::PipelineHandle m_pipeline;
 
     // XR_DOCS_TAG_BEGIN_Objects
     // An instance of a 3d colored block.
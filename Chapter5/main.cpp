@@ -5,6 +5,7 @@
 // OpenXR Tutorial for Khronos Group
 
 #include <DebugOutput.h>
+#include <cstdlib>
 // XR_DOCS_TAG_BEGIN_include_GraphicsAPI_D3D11
 #include <GraphicsAPI_D3D11.h>
 // XR_DOCS_TAG_END_include_GraphicsAPI_D3D11
@@ -64,6 +65,12 @@ public:
             XR_TUT_LOG_ERROR("ERROR: The provided Graphics API is not valid for this platform.");
             DEBUG_BREAK;
         }
+#if !defined(XR_TUTORIAL_DYNAMIC_GRAPHICS_API)
+        if (m_apiType != XR_TUTORIAL_GRAPHICS_API) {
+            XR_TUT_LOG_ERROR("ERROR: The provided Graphics API is not XR_TUTORIAL_GRAPHICS_API. Define XR_TUTORIAL_DYNAMIC_GRAPHICS_API to select it at runtime.");
+            DEBUG_BREAK;
+        }
+#endif
     }
     ~OpenXRTutorial() = default;
 
@@ -162,6 +169,18 @@ private:
             // Ensure m_apiType is already defined when we call this line.
             m_instanceExtensions.push_back(GetGraphicsAPIInstanceExtensionString(m_apiType));
             // XR_DOCS_TAG_END_instanceExtensions
+#if defined(XR_TUTORIAL_USE_OPENGL_EGL)
+            // A headless OpenGL context is passed to the runtime as an EGL binding.
+            if (m_apiType == OPENGL) {
+                m_instanceExtensions.push_back(XR_MNDX_EGL_ENABLE_EXTENSION_NAME);
+            }
+#endif
+#if defined(XR_USE_GRAPHICS_API_OPENGL_ES) && !defined(__ANDROID__)
+            // So is the OpenGL ES context on desktop Linux.
+            if (m_apiType == OPENGL_ES) {
+                m_instanceExtensions.push_back(XR_MNDX_EGL_ENABLE_EXTENSION_NAME);
+            }
+#endif
             // XR_DOCS_TAG_BEGIN_handTrackingExtensions
             m_instanceExtensions.push_back(XR_EXT_HAND_TRACKING_EXTENSION_NAME);
             m_instanceExtensions.push_back(XR_EXT_HAND_INTERACTION_EXTENSION_NAME);
@@ -538,12 +557,22 @@ private:
 #endif
         } else if (m_apiType == VULKAN) {
 #if defined(XR_USE_GRAPHICS_API_VULKAN)
-            m_graphicsAPI = std::make_unique<GraphicsAPI_Vulkan>(m_xrInstance, m_systemID);
+            // The instance buffers are written to a separate set per frame that may be in flight.
+            m_graphicsAPI = std::make_unique<GraphicsAPI_Vulkan>(m_xrInstance, m_systemID, m_framesInFlight);
 #endif
         } else {
             XR_TUT_LOG_ERROR("ERROR: Unknown Graphics API.");
             DEBUG_BREAK;
         }
+#if !defined(XR_TUTORIAL_DYNAMIC_GRAPHICS_API)
+        // m_renderer is the compiled backend's class, so casting any other GraphicsAPI to it is undefined behaviour.
+        if (m_apiType != XR_TUTORIAL_GRAPHICS_API || !m_graphicsAPI) {
+            XR_TUT_LOG_ERROR("ERROR: The Graphics API does not match XR_TUTORIAL_GRAPHICS_API. Define XR_TUTORIAL_DYNAMIC_GRAPHICS_API to select it at runtime.");
+            DEBUG_BREAK;
+            std::abort();
+        }
+#endif
+        m_renderer = static_cast<GraphicsAPI_Renderer *>(m_graphicsAPI.get());
         // Fill out the XrSessionCreateInfo structure and create an XrSession.
         //  XR_DOCS_TAG_BEGIN_CreateSession2
         sessionCI.next = m_graphicsAPI->GetGraphicsBinding();
@@ -587,6 +616,11 @@ private:
         {0.00f, 0.00f, 1.00f, 0},
         {0.00f, 0.0f, -1.00f, 0}};
     // XR_DOCS_TAG_END_CreateResources1
+    // Per-instance vertex data read by the VertexShader_Instanced shaders: the cuboid's model matrix and color.
+    struct CuboidInstance {
+        XrMatrix4x4f model;
+        XrVector4f color;
+    };
 
     void CreateResources() {
         // XR_DOCS_TAG_BEGIN_CreateResources1_1
@@ -621,9 +655,9 @@ private:
             30, 31, 32, 33, 34, 35,  // +Z
         };
 
-        m_vertexBuffer = m_graphicsAPI->CreateBuffer({GraphicsAPI::BufferCreateInfo::Type::VERTEX, sizeof(float) * 4, sizeof(cubeVertices), &cubeVertices});
+        m_vertexBuffer = m_graphicsAPI->CreateBuffer({GraphicsAPI::BufferCreateInfo::Type::VERTEX, sizeof(float) * 4, sizeof(cubeVertices), &cubeVertices, GraphicsAPI::BufferCreateInfo::Usage::STATIC});
 
-        m_indexBuffer = m_graphicsAPI->CreateBuffer({GraphicsAPI::BufferCreateInfo::Type::INDEX, sizeof(uint32_t), sizeof(cubeIndices), &cubeIndices});
+        m_indexBuffer = m_graphicsAPI->CreateBuffer({GraphicsAPI::BufferCreateInfo::Type::INDEX, sizeof(uint32_t), sizeof(cubeIndices), &cubeIndices, GraphicsAPI::BufferCreateInfo::Usage::STATIC});
 
         // XR_DOCS_TAG_BEGIN_Update_numberOfCuboids
         size_t numberOfCuboids = 64 + 2 + 2;
@@ -631,8 +665,8 @@ private:
         // XR_DOCS_TAG_BEGIN_AddHandCuboids
         numberOfCuboids += XR_HAND_JOINT_COUNT_EXT * 2;
         // XR_DOCS_TAG_END_AddHandCuboids
-        m_uniformBuffer_Camera = m_graphicsAPI->CreateBuffer({GraphicsAPI::BufferCreateInfo::Type::UNIFORM, 0, sizeof(CameraConstants) * numberOfCuboids, nullptr});
-        m_uniformBuffer_Normals = m_graphicsAPI->CreateBuffer({GraphicsAPI::BufferCreateInfo::Type::UNIFORM, 0, sizeof(normals), &normals});
+        m_cuboidInstances.reserve(numberOfCuboids);
+        m_uniformBuffer_Normals = m_graphicsAPI->CreateBuffer({GraphicsAPI::BufferCreateInfo::Type::UNIFORM, 0, sizeof(normals), &normals, GraphicsAPI::BufferCreateInfo::Usage::STATIC});
         // XR_DOCS_TAG_END_CreateResources1_1
 
         // XR_DOCS_TAG_BEGIN_CreateResources2_OpenGL
@@ -644,6 +678,16 @@ private:
             m_fragmentShader = m_graphicsAPI->CreateShader({GraphicsAPI::ShaderCreateInfo::Type::FRAGMENT, fragmentSource.data(), fragmentSource.size()});
         }
         // XR_DOCS_TAG_END_CreateResources2_OpenGL
+#if !defined(__ANDROID__)
+        // OpenGL ES on desktop Linux reads the _GLES shaders from the working directory instead of the Android assets.
+        if (m_apiType == OPENGL_ES) {
+            std::string vertexSource = ReadTextFile("VertexShader_GLES.glsl");
+            m_vertexShader = m_graphicsAPI->CreateShader({GraphicsAPI::ShaderCreateInfo::Type::VERTEX, vertexSource.data(), vertexSource.size()});
+
+            std::string fragmentSource = ReadTextFile("PixelShader_GLES.glsl");
+            m_fragmentShader = m_graphicsAPI->CreateShader({GraphicsAPI::ShaderCreateInfo::Type::FRAGMENT, fragmentSource.data(), fragmentSource.size()});
+        }
+#endif
         // XR_DOCS_TAG_BEGIN_CreateResources2_VulkanWindowsLinux
         if (m_apiType == VULKAN) {
             std::vector<char> vertexSource = ReadBinaryFile("VertexShader.spv");
@@ -706,6 +750,51 @@ private:
         m_pipeline = m_graphicsAPI->CreatePipeline(pipelineCI);
         // XR_DOCS_TAG_END_CreateResources3
 
+        // The instanced pipeline draws all the cuboids of a view with one call. Its second vertex buffer advances once per
+        // instance, and holds the model matrix in attributes 1 to 4, and the color in attribute 5.
+        if (m_apiType == OPENGL) {
+            std::string vertexSource = ReadTextFile("VertexShader_Instanced.glsl");
+            m_instancedVertexShader = m_graphicsAPI->CreateShader({GraphicsAPI::ShaderCreateInfo::Type::VERTEX, vertexSource.data(), vertexSource.size()});
+        }
+        if (m_apiType == VULKAN) {
+#if defined(__ANDROID__)
+            std::vector<char> vertexSource = ReadBinaryFile("shaders/VertexShader_Instanced.spv", androidApp->activity->assetManager);
+#else
+            std::vector<char> vertexSource = ReadBinaryFile("VertexShader_Instanced.spv");
+#endif
+            m_instancedVertexShader = m_graphicsAPI->CreateShader({GraphicsAPI::ShaderCreateInfo::Type::VERTEX, vertexSource.data(), vertexSource.size()});
+        }
+        if (m_apiType == OPENGL_ES) {
+#if defined(__ANDROID__)
+            std::string vertexSource = ReadTextFile("shaders/VertexShader_Instanced_GLES.glsl", androidApp->activity->assetManager);
+#else
+            std::string vertexSource = ReadTextFile("VertexShader_Instanced_GLES.glsl");
+#endif
+            m_instancedVertexShader = m_graphicsAPI->CreateShader({GraphicsAPI::ShaderCreateInfo::Type::VERTEX, vertexSource.data(), vertexSource.size()});
+        }
+        if (m_apiType == D3D11) {
+            std::vector<char> vertexSource = ReadBinaryFile("VertexShader_Instanced_5_0.cso");
+            m_instancedVertexShader = m_graphicsAPI->CreateShader({GraphicsAPI::ShaderCreateInfo::Type::VERTEX, vertexSource.data(), vertexSource.size()});
+        }
+        if (m_apiType == D3D12) {
+            std::vector<char> vertexSource = ReadBinaryFile("VertexShader_Instanced_5_1.cso");
+            m_instancedVertexShader = m_graphicsAPI->CreateShader({GraphicsAPI::ShaderCreateInfo::Type::VERTEX, vertexSource.data(), vertexSource.size()});
+        }
+        pipelineCI.shaders = {m_instancedVertexShader, m_fragmentShader};
+        pipelineCI.vertexInputState.attributes = {{0, 0, GraphicsAPI::VertexType::VEC4, 0, "TEXCOORD"},
+                                                  {1, 1, GraphicsAPI::VertexType::VEC4, 0 * sizeof(float), "TEXCOORD"},
+                                                  {2, 1, GraphicsAPI::VertexType::VEC4, 4 * sizeof(float), "TEXCOORD"},
+                                                  {3, 1, GraphicsAPI::VertexType::VEC4, 8 * sizeof(float), "TEXCOORD"},
+                                                  {4, 1, GraphicsAPI::VertexType::VEC4, 12 * sizeof(float), "TEXCOORD"},
+                                                  {5, 1, GraphicsAPI::VertexType::VEC4, 16 * sizeof(float), "TEXCOORD"}};
+        pipelineCI.vertexInputState.bindings = {{0, 0, 4 * sizeof(float)},
+                                                {1, 0, sizeof(CuboidInstance), GraphicsAPI::VertexInputRate::INSTANCE}};
+        // The view-projection matrix is the only per-draw value, so it's a push constant rather than a uniform buffer.
+        pipelineCI.layout = {{1, nullptr, GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::VERTEX},
+                             {2, nullptr, GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::FRAGMENT}};
+        pipelineCI.pushConstantRanges = {{GraphicsAPI::DescriptorInfo::Stage::VERTEX, 0, sizeof(XrMatrix4x4f)}};
+        m_instancedPipeline = m_graphicsAPI->CreatePipeline(pipelineCI);
+
         // XR_DOCS_TAG_BEGIN_Setup_Blocks
         // Create sixty-four cubic blocks, 20cm wide, evenly distributed,
         // and randomly colored.
@@ -730,11 +819,18 @@ private:
         // XR_DOCS_TAG_END_Setup_Blocks
     }
     void DestroyResources() {
+        for (size_t setIndex = 0; setIndex < m_framesInFlight; setIndex++) {
+            if (m_instanceBuffers[setIndex].buffer) {
+                m_graphicsAPI->DestroyBuffer(m_instanceBuffers[setIndex].buffer);
+            }
+            DestroyRetiredInstanceBuffers(setIndex);
+        }
+        m_graphicsAPI->DestroyPipeline(m_instancedPipeline);
+        m_graphicsAPI->DestroyShader(m_instancedVertexShader);
         // XR_DOCS_TAG_BEGIN_DestroyResources
         m_graphicsAPI->DestroyPipeline(m_pipeline);
         m_graphicsAPI->DestroyShader(m_fragmentShader);
         m_graphicsAPI->DestroyShader(m_vertexShader);
-        m_graphicsAPI->DestroyBuffer(m_uniformBuffer_Camera);
         m_graphicsAPI->DestroyBuffer(m_uniformBuffer_Normals);
         m_graphicsAPI->DestroyBuffer(m_indexBuffer);
         m_graphicsAPI->DestroyBuffer(m_vertexBuffer);
@@ -1115,31 +1211,63 @@ private:
         // XR_DOCS_TAG_END_DestroySwapchains
     }
 
-    // XR_DOCS_TAG_BEGIN_RenderCuboid1
-    size_t renderCuboidIndex = 0;
-    // XR_DOCS_TAG_END_RenderCuboid1
     void RenderCuboid(XrPosef pose, XrVector3f scale, XrVector3f color) {
         // XR_DOCS_TAG_BEGIN_RenderCuboid2
-        XrMatrix4x4f_CreateTranslationRotationScale(&cameraConstants.model, &pose.position, &pose.orientation, &scale);
+        // The cuboid is only recorded here. All the cuboids of the frame are uploaded once and drawn in each view by DrawCuboidBatch().
+        CuboidInstance instance;
+        XrMatrix4x4f_CreateTranslationRotationScale(&instance.model, &pose.position, &pose.orientation, &scale);
+        instance.color = {color.x, color.y, color.z, 1.0};
+        m_cuboidInstances.push_back(instance);
+        // XR_DOCS_TAG_END_RenderCuboid2
+    }
 
-        XrMatrix4x4f_Multiply(&cameraConstants.modelViewProj, &cameraConstants.viewProj, &cameraConstants.model);
-        cameraConstants.color = {color.x, color.y, color.z, 1.0};
-        size_t offsetCameraUB = sizeof(CameraConstants) * renderCuboidIndex;
+    void UploadCuboidInstances() {
+        if (m_cuboidInstances.empty()) {
+            return;
+        }
+        const size_t instanceCount = m_cuboidInstances.size();
 
-        m_graphicsAPI->SetPipeline(m_pipeline);
+        // Grow this frame's instance buffer geometrically, so the number of cuboids is only bounded by memory.
+        InstanceBuffer &instanceBuffer = m_instanceBuffers[m_instanceBufferSetIndex];
+        if (instanceBuffer.capacity < instanceCount) {
+            if (instanceBuffer.buffer) {
+                instanceBuffer.retiredBuffers.push_back(instanceBuffer.buffer);
+            }
+            instanceBuffer.capacity = std::max(instanceCount, std::max(m_cuboidInstances.capacity(), instanceBuffer.capacity * 2));
+            instanceBuffer.buffer = m_renderer->CreateBuffer({GraphicsAPI::BufferCreateInfo::Type::VERTEX, sizeof(CuboidInstance), sizeof(CuboidInstance) * instanceBuffer.capacity, nullptr, GraphicsAPI::BufferCreateInfo::Usage::DYNAMIC});
+        }
+        m_renderer->SetBufferData(instanceBuffer.buffer, 0, sizeof(CuboidInstance) * instanceCount, m_cuboidInstances.data());
+    }
 
-        m_graphicsAPI->SetBufferData(m_uniformBuffer_Camera, offsetCameraUB, sizeof(CameraConstants), &cameraConstants);
-        m_graphicsAPI->SetDescriptor({0, m_uniformBuffer_Camera, GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::VERTEX, false, offsetCameraUB, sizeof(CameraConstants)});
-        m_graphicsAPI->SetDescriptor({1, m_uniformBuffer_Normals, GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::VERTEX, false, 0, sizeof(normals)});
+    void DestroyRetiredInstanceBuffers(size_t setIndex) {
+        InstanceBuffer &instanceBuffer = m_instanceBuffers[setIndex];
+        for (GraphicsAPI::BufferHandle &retiredBuffer : instanceBuffer.retiredBuffers) {
+            m_graphicsAPI->DestroyBuffer(retiredBuffer);
+        }
+        instanceBuffer.retiredBuffers.clear();
+    }
 
-        m_graphicsAPI->UpdateDescriptors();
+    void DrawCuboidBatch() {
+        if (m_cuboidInstances.empty()) {
+            return;
+        }
+        const InstanceBuffer &instanceBuffer = m_instanceBuffers[m_instanceBufferSetIndex];
 
-        m_graphicsAPI->SetVertexBuffers(&m_vertexBuffer, 1);
-        m_graphicsAPI->SetIndexBuffer(m_indexBuffer);
-        m_graphicsAPI->DrawIndexed(36);
+        m_renderer->SetPipeline(m_instancedPipeline);
 
-        renderCuboidIndex++;
-        // XR_DOCS_TAG_END_RenderCuboid2
+        // Only static buffers are bound through descriptors, so the descriptors are the same for every view and frame.
+        m_renderer->SetPushConstants(GraphicsAPI::DescriptorInfo::Stage::VERTEX, 0, sizeof(XrMatrix4x4f), &cameraConstants.viewProj);
+        m_renderer->SetDescriptor({1, m_uniformBuffer_Normals.ToPointer(), GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::VERTEX, false, 0, sizeof(normals)});
+
+        m_renderer->UpdateDescriptors();
+
+        GraphicsAPI::BufferHandle vertexBuffers[] = {m_vertexBuffer, instanceBuffer.buffer};
+        m_renderer->SetVertexBuffers(vertexBuffers, 2);
+        m_renderer->SetIndexBuffer(m_indexBuffer);
+        // The batch is submitted as one indirect command per mesh, whose instances start at firstInstance in the instance buffer.
+        // The cube is the only mesh, so there's one command. Where multi-draw indirect isn't supported, this is a single DrawIndexed().
+        GraphicsAPI::DrawIndexedIndirectCommand drawCommand = {36, static_cast<uint32_t>(m_cuboidInstances.size()), 0, 0, 0};
+        m_renderer->MultiDrawIndexedIndirect(&drawCommand, 1);
     }
 
     void RenderFrame() {
@@ -1213,6 +1341,56 @@ private:
         // XR_DOCS_TAG_END_ResizeLeyerDepthInfos
 #endif
 
+        // The depth swapchain images are only needed after rendering, if they're submitted to the compositor.
+        m_renderer->SetStoreDepthAttachment(XR_DOCS_CHAPTER_VERSION == XR_DOCS_CHAPTER_5_2);
+
+        // Record all views into one frame, so the graphics API can submit them together.
+        m_renderer->BeginFrame();
+        m_instanceBufferSetIndex = (m_instanceBufferSetIndex + 1) % m_framesInFlight;
+        // The frame that last used this set is done, so the buffers that it outgrew can be destroyed.
+        DestroyRetiredInstanceBuffers(m_instanceBufferSetIndex);
+
+        // The cuboids are the same in every view, so they're recorded and uploaded once per frame. Only viewProj changes between views.
+        m_cuboidInstances.clear();
+        // XR_DOCS_TAG_BEGIN_CallRenderCuboid
+        // Draw a floor. Scale it by 2 in the X and Z, and 0.1 in the Y,
+        RenderCuboid({{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, -m_viewHeightM, 0.0f}}, {2.0f, 0.1f, 2.0f}, {0.4f, 0.5f, 0.5f});
+        // Draw a "table".
+        RenderCuboid({{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, -m_viewHeightM + 0.9f, -0.7f}}, {1.0f, 0.2f, 1.0f}, {0.6f, 0.6f, 0.4f});
+        // XR_DOCS_TAG_END_CallRenderCuboid
+
+        // XR_DOCS_TAG_BEGIN_CallRenderCuboid2
+        // Draw some blocks at the controller positions:
+        for (int j = 0; j < 2; j++) {
+            if (m_handPoseState[j].isActive) {
+                RenderCuboid(m_handPose[j], {0.02f, 0.04f, 0.10f}, {1.f, 1.f, 1.f});
+            }
+        }
+        for (int j = 0; j < m_blocks.size(); j++) {
+            auto &thisBlock = m_blocks[j];
+            XrVector3f sc = thisBlock.scale;
+            if (j == m_nearBlock[0] || j == m_nearBlock[1])
+                sc = thisBlock.scale * 1.05f;
+            RenderCuboid(thisBlock.pose, sc, thisBlock.color);
+        }
+        // XR_DOCS_TAG_END_CallRenderCuboid2
+
+        // XR_DOCS_TAG_BEGIN_RenderHands
+        if (handTrackingSystemProperties.supportsHandTracking) {
+            for (int j = 0; j < 2; j++) {
+                auto hand = m_hands[j];
+                XrVector3f hand_color = {1.f, 1.f, 0.f};
+                for (int k = 0; k < XR_HAND_JOINT_COUNT_EXT; k++) {
+                    XrVector3f sc = {1.5f, 1.5f, 2.5f};
+                    sc = sc * hand.m_jointLocations[k].radius;
+                    RenderCuboid(hand.m_jointLocations[k].pose, sc, hand_color);
+                }
+            }
+        }
+        // XR_DOCS_TAG_END_RenderHands
+
+        UploadCuboidInstances();
+
         // Per view in the view configuration:
         for (uint32_t i = 0; i < viewCount; i++) {
             SwapchainInfo &colorSwapchainInfo = m_colorSwapchainInfos[i];
@@ -1269,22 +1447,22 @@ private:
 #endif
 
             // Rendering code to clear the color and depth image views.
-            m_graphicsAPI->BeginRendering();
+            m_renderer->BeginRendering();
 
             if (m_environmentBlendMode == XR_ENVIRONMENT_BLEND_MODE_OPAQUE) {
                 // VR mode use a background color.
-                m_graphicsAPI->ClearColor(colorSwapchainInfo.imageViews[colorImageIndex], 0.17f, 0.17f, 0.17f, 1.00f);
+                m_renderer->ClearColor(colorSwapchainInfo.imageViews[colorImageIndex], 0.17f, 0.17f, 0.17f, 1.00f);
             } else {
                 // In AR mode make the background color black.
-                m_graphicsAPI->ClearColor(colorSwapchainInfo.imageViews[colorImageIndex], 0.00f, 0.00f, 0.00f, 1.00f);
+                m_renderer->ClearColor(colorSwapchainInfo.imageViews[colorImageIndex], 0.00f, 0.00f, 0.00f, 1.00f);
             }
-            m_graphicsAPI->ClearDepth(depthSwapchainInfo.imageViews[depthImageIndex], 1.0f);
+            m_renderer->ClearDepth(depthSwapchainInfo.imageViews[depthImageIndex], 1.0f);
             // XR_DOCS_TAG_END_RenderLayer1
 
             // XR_DOCS_TAG_BEGIN_SetupFrameRendering
-            m_graphicsAPI->SetRenderAttachments(&colorSwapchainInfo.imageViews[colorImageIndex], 1, depthSwapchainInfo.imageViews[depthImageIndex], width, height, m_pipeline);
-            m_graphicsAPI->SetViewports(&viewport, 1);
-            m_graphicsAPI->SetScissors(&scissor, 1);
+            m_renderer->SetRenderAttachments(&colorSwapchainInfo.imageViews[colorImageIndex], 1, depthSwapchainInfo.imageViews[depthImageIndex], width, height, m_pipeline);
+            m_renderer->SetViewports(&viewport, 1);
+            m_renderer->SetScissors(&scissor, 1);
 
             // Compute the view-projection transform.
             // All matrices (including OpenXR's) are column-major, right-handed.
@@ -1298,51 +1476,21 @@ private:
             XrMatrix4x4f_Multiply(&cameraConstants.viewProj, &proj, &view);
             // XR_DOCS_TAG_END_SetupFrameRendering
 
-            // XR_DOCS_TAG_BEGIN_CallRenderCuboid
-            renderCuboidIndex = 0;
-            // Draw a floor. Scale it by 2 in the X and Z, and 0.1 in the Y,
-            RenderCuboid({{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, -m_viewHeightM, 0.0f}}, {2.0f, 0.1f, 2.0f}, {0.4f, 0.5f, 0.5f});
-            // Draw a "table".
-            RenderCuboid({{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, -m_viewHeightM + 0.9f, -0.7f}}, {1.0f, 0.2f, 1.0f}, {0.6f, 0.6f, 0.4f});
-            // XR_DOCS_TAG_END_CallRenderCuboid
 
-            // XR_DOCS_TAG_BEGIN_CallRenderCuboid2
-            // Draw some blocks at the controller positions:
-            for (int j = 0; j < 2; j++) {
-                if (m_handPoseState[j].isActive) {
-                    RenderCuboid(m_handPose[j], {0.02f, 0.04f, 0.10f}, {1.f, 1.f, 1.f});
-                }
-            }
-            for (int j = 0; j < m_blocks.size(); j++) {
-                auto &thisBlock = m_blocks[j];
-                XrVector3f sc = thisBlock.scale;
-                if (j == m_nearBlock[0] || j == m_nearBlock[1])
-                    sc = thisBlock.scale * 1.05f;
-                RenderCuboid(thisBlock.pose, sc, thisBlock.color);
-            }
-            // XR_DOCS_TAG_END_CallRenderCuboid2
-
-            // XR_DOCS_TAG_BEGIN_RenderHands
-            if (handTrackingSystemProperties.supportsHandTracking) {
-                for (int j = 0; j < 2; j++) {
-                    auto hand = m_hands[j];
-                    XrVector3f hand_color = {1.f, 1.f, 0.f};
-                    for (int k = 0; k < XR_HAND_JOINT_COUNT_EXT; k++) {
-                        XrVector3f sc = {1.5f, 1.5f, 2.5f};
-                        sc = sc * hand.m_jointLocations[k].radius;
-                        RenderCuboid(hand.m_jointLocations[k].pose, sc, hand_color);
-                    }
-                }
-            }
-            // XR_DOCS_TAG_END_RenderHands
+            DrawCuboidBatch();
 
             // XR_DOCS_TAG_BEGIN_RenderLayer2
-            m_graphicsAPI->EndRendering();
+            m_renderer->EndRendering();
+        }
+
+        // Submit the frame before any of its swapchain images are released.
+        m_renderer->EndFrame();
 
+        for (uint32_t i = 0; i < viewCount; i++) {
             // Give the swapchain image back to OpenXR, allowing the compositor to use the image.
             XrSwapchainImageReleaseInfo releaseInfo{XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
-            OPENXR_CHECK(xrReleaseSwapchainImage(colorSwapchainInfo.swapchain, &releaseInfo), "Failed to release Image back to the Color Swapchain");
-            OPENXR_CHECK(xrReleaseSwapchainImage(depthSwapchainInfo.swapchain, &releaseInfo), "Failed to release Image back to the Depth Swapchain");
+            OPENXR_CHECK(xrReleaseSwapchainImage(m_colorSwapchainInfos[i].swapchain, &releaseInfo), "Failed to release Image back to the Color Swapchain");
+            OPENXR_CHECK(xrReleaseSwapchainImage(m_depthSwapchainInfos[i].swapchain, &releaseInfo), "Failed to release Image back to the Depth Swapchain");
         }
 
         // Fill out the XrCompositionLayerProjection structure for usage with xrEndFrame().
@@ -1451,6 +1599,14 @@ private:
 
     GraphicsAPI_Type m_apiType = UNKNOWN;
     std::unique_ptr<GraphicsAPI> m_graphicsAPI = nullptr;
+    // Rendering calls the backend through its final class, so the per-frame and per-draw calls aren't virtual. Define
+    // XR_TUTORIAL_DYNAMIC_GRAPHICS_API to call it through the GraphicsAPI interface instead, when the backend is chosen at runtime.
+#if defined(XR_TUTORIAL_DYNAMIC_GRAPHICS_API)
+    typedef GraphicsAPI GraphicsAPI_Renderer;
+#else
+    typedef GraphicsAPI_Backend<XR_TUTORIAL_GRAPHICS_API>::Type GraphicsAPI_Renderer;
+#endif
+    GraphicsAPI_Renderer *m_renderer = nullptr;
 
     XrSession m_session = {};
     XrSessionState m_sessionState = XR_SESSION_STATE_UNKNOWN;
@@ -1491,18 +1647,33 @@ private:
     float m_viewHeightM = 1.5f;
 
     // Vertex and index buffers: geometry for our cuboids.
-    void *m_vertexBuffer = nullptr;
-    void *m_indexBuffer = nullptr;
-    // Camera values constant buffer for the shaders.
-    void *m_uniformBuffer_Camera = nullptr;
+    GraphicsAPI::BufferHandle m_vertexBuffer;
+    GraphicsAPI::BufferHandle m_indexBuffer;
     // The normals are stored in a uniform buffer to simplify our vertex geometry.
-    void *m_uniformBuffer_Normals = nullptr;
+    GraphicsAPI::BufferHandle m_uniformBuffer_Normals;
 
     // We use only two shaders in this app.
     void *m_vertexShader = nullptr, *m_fragmentShader = nullptr;
 
     // The pipeline is a graphics-API specific state object.
-    void *m_pipeline = nullptr;
+    GraphicsAPI::PipelineHandle m_pipeline;
+
+    // Instanced path: all the cuboids of a view are drawn with one call.
+    void *m_instancedVertexShader = nullptr;
+    GraphicsAPI::PipelineHandle m_instancedPipeline;
+    std::vector<CuboidInstance> m_cuboidInstances;
+    // The instance buffers grow with the number of cuboids. All views of a frame share one, and there is one per frame that may be
+    // in flight, so that a frame's instance data isn't overwritten while the GPU may still read it. The other backends either wait
+    // for each frame or manage the buffer copies themselves, so this matches the frames in flight requested from Vulkan.
+    static constexpr uint32_t m_framesInFlight = 2;
+    struct InstanceBuffer {
+        GraphicsAPI::BufferHandle buffer;
+        size_t capacity = 0;
+        // Outgrown buffers may still be in use by the GPU until this set comes round again.
+        std::vector<GraphicsAPI::BufferHandle> retiredBuffers;
+    };
+    InstanceBuffer m_instanceBuffers[m_framesInFlight];
+    size_t m_instanceBufferSetIndex = 0;
 
     // XR_DOCS_TAG_BEGIN_Objects
     // An instance of a 3d colored block.
@@ -1513,8 +1684,6 @@ private:
     };
     // The list of block instances.
     std::vector<Block> m_blocks;
-    // Don't let too many m_blocks get created.
-    const size_t m_maxBlockCount = 100;
     // Which block, if any, is being held by each of the user's hands or controllers.
     int m_grabbedBlock[2] = {-1, -1};
     // Which block, if any, is nearby to each hand or controller.
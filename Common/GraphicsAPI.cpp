@@ -10,6 +10,11 @@ bool CheckGraphicsAPI_TypeIsValidForPlatform(GraphicsAPI_Type type) {
 #if defined(XR_USE_PLATFORM_WIN32)
     return (type == D3D11) || (type == D3D12) || (type == OPENGL) || (type == VULKAN);
 #elif defined(XR_USE_PLATFORM_XLIB) || defined(XR_USE_PLATFORM_XCB) || defined(XR_USE_PLATFORM_WAYLAND)
+#if defined(XR_USE_GRAPHICS_API_OPENGL_ES)
+    if (type == OPENGL_ES) {
+        return true;
+    }
+#endif
     return (type == OPENGL) || (type == VULKAN);
 #elif defined(XR_USE_PLATFORM_ANDROID) || defined(XR_USE_PLATFORM_XCB) || defined(XR_USE_PLATFORM_WAYLAND)
     return (type == OPENGL_ES) || (type == VULKAN);
@@ -48,6 +53,87 @@ const char *GetGraphicsAPIInstanceExtensionString(GraphicsAPI_Type type) {
     return nullptr;
 }
 
+#if defined(XR_USE_PLATFORM_EGL)
+bool EGLHeadlessContext::Create(EGLenum api, EGLint renderableType, const EGLint *contextAttribs) {
+    // Prefer Mesa's surfaceless platform, which needs no display server at all. Otherwise use the default display and a pbuffer.
+    const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (clientExtensions && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") && eglGetPlatformDisplayEXT) {
+        display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint eglMajorVersion = 0;
+    EGLint eglMinorVersion = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajorVersion, &eglMinorVersion)) {
+        std::cout << "ERROR: EGL: Failed to initialize EGL display." << std::endl;
+        return false;
+    }
+    if (!eglBindAPI(api)) {
+        std::cout << "ERROR: EGL: EGL display does not support the requested client API." << std::endl;
+        return false;
+    }
+
+    // Without EGL_KHR_surfaceless_context the context needs a drawable, so fall back to a small pbuffer.
+    const char *displayExtensions = eglQueryString(display, EGL_EXTENSIONS);
+    const bool surfaceless = displayExtensions && strstr(displayExtensions, "EGL_KHR_surfaceless_context");
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, renderableType,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE};
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0) {
+        std::cout << "ERROR: EGL: Failed to find a suitable EGLConfig." << std::endl;
+        return false;
+    }
+
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        std::cout << "ERROR: EGL: Failed to create EGLContext." << std::endl;
+        return false;
+    }
+
+    if (!surfaceless) {
+        const EGLint pbufferAttribs[] = {EGL_WIDTH, 640, EGL_HEIGHT, 480, EGL_NONE};
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+        if (surface == EGL_NO_SURFACE) {
+            std::cout << "ERROR: EGL: Failed to create EGL pbuffer surface." << std::endl;
+            return false;
+        }
+    }
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        std::cout << "ERROR: EGL: Failed to make EGLContext current." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void EGLHeadlessContext::Destroy() {
+    if (display == EGL_NO_DISPLAY) {
+        return;
+    }
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface != EGL_NO_SURFACE) {
+        eglDestroySurface(display, surface);
+        surface = EGL_NO_SURFACE;
+    }
+    if (context != EGL_NO_CONTEXT) {
+        eglDestroyContext(display, context);
+        context = EGL_NO_CONTEXT;
+    }
+    eglTerminate(display);
+    display = EGL_NO_DISPLAY;
+}
+#endif
+
 // GraphicsAPI
 
 // XR_DOCS_TAG_BEGIN_GraphicsAPI_SelectSwapchainFormats
@@ -46,6 +46,14 @@
 #if defined(XR_TUTORIAL_USE_OPENGL)
 #define XR_USE_GRAPHICS_API_OPENGL
 #endif
+#if defined(XR_TUTORIAL_USE_OPENGL_ES)
+#define XR_USE_GRAPHICS_API_OPENGL_ES
+#endif
+#if (defined(XR_TUTORIAL_USE_OPENGL) && defined(XR_TUTORIAL_USE_OPENGL_EGL)) || defined(XR_TUTORIAL_USE_OPENGL_ES)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#define XR_USE_PLATFORM_EGL
+#endif
 #if defined(XR_TUTORIAL_USE_VULKAN)
 #define XR_USE_GRAPHICS_API_VULKAN
 #endif
@@ -94,6 +102,23 @@
 #endif
 
 #if defined(XR_USE_GRAPHICS_API_OPENGL_ES)
+#if !defined(__ANDROID__)
+// On desktop Linux, gfxwrapper provides the GL headers and function loader. The OpenGL ES context itself is created through EGL.
+#if defined(XR_USE_PLATFORM_XLIB)
+#define OS_LINUX_XLIB 1
+#endif
+#if defined(XR_USE_PLATFORM_XCB)
+#define OS_LINUX_XCB 1
+#endif
+#if defined(XR_USE_PLATFORM_WAYLAND)
+#define OS_LINUX_WAYLAND 1
+#endif
+
+// gfxwrapper will redefine these macros
+#undef XR_USE_PLATFORM_XLIB
+#undef XR_USE_PLATFORM_XCB
+#undef XR_USE_PLATFORM_WAYLAND
+#endif
 #include <gfxwrapper_opengl.h>
 #endif
 
@@ -117,8 +142,137 @@ bool CheckGraphicsAPI_TypeIsValidForPlatform(GraphicsAPI_Type type);
 
 const char* GetGraphicsAPIInstanceExtensionString(GraphicsAPI_Type type);
 
+#if defined(XR_USE_PLATFORM_EGL)
+// A context created directly through EGL, without a window or display server. It's used by the headless OpenGL path and by OpenGL ES
+// on desktop Linux, which only differ in the client API, the renderable type of the config and the attributes of the context.
+struct EGLHeadlessContext {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLConfig config = nullptr;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE;
+
+    // api is EGL_OPENGL_API or EGL_OPENGL_ES_API. contextAttribs is terminated by EGL_NONE. On success, the context is current.
+    bool Create(EGLenum api, EGLint renderableType, const EGLint* contextAttribs);
+    void Destroy();
+};
+#endif
+
+// A typed, 32-bit handle to an element of a SlotMap. The low bits are the index of the slot, and the high bits are the generation
+// of the slot, which changes whenever the slot is freed, so a handle to a destroyed element no longer matches. 0 is never a valid handle.
+template <typename Tag>
+struct Handle {
+    static constexpr uint32_t indexBits = 20;
+    static constexpr uint32_t indexMask = (1u << indexBits) - 1;
+    static constexpr uint32_t generationMask = (1u << (32 - indexBits)) - 1;
+    uint32_t value = 0;
+
+    uint32_t Index() const { return value & indexMask; }
+    uint32_t Generation() const { return value >> indexBits; }
+    explicit operator bool() const { return value != 0; }
+    bool operator==(const Handle& other) const { return value == other.value; }
+    bool operator!=(const Handle& other) const { return value != other.value; }
+
+    // A BUFFER descriptor's resource is a void*, which carries the handle's value.
+    void* ToPointer() const { return (void*)(uintptr_t)value; }
+    static Handle FromPointer(const void* pointer) {
+        Handle handle;
+        handle.value = (uint32_t)(uintptr_t)pointer;
+        return handle;
+    }
+};
+
+// Dense storage for backend objects, addressed by Handle. A lookup is an array index rather than a hash, and in debug builds it
+// also checks the generation, so that the use of a destroyed or foreign handle is reported instead of silently reading another object.
+// References into the SlotMap are invalidated by Insert().
+template <typename T, typename Tag>
+class SlotMap {
+public:
+    typedef ::Handle<Tag> HandleType;
+
+    HandleType Insert(const T& data) {
+        uint32_t index = 0;
+        if (!freeIndices.empty()) {
+            index = freeIndices.back();
+            freeIndices.pop_back();
+        } else {
+            index = static_cast<uint32_t>(slots.size());
+            if (index > HandleType::indexMask) {
+                std::cout << "ERROR: SlotMap: Out of handles." << std::endl;
+                DEBUG_BREAK;
+            }
+            slots.push_back(Slot());
+        }
+        Slot& slot = slots[index];
+        slot.data = data;
+        slot.occupied = true;
+        HandleType handle;
+        handle.value = (slot.generation << HandleType::indexBits) | index;
+        return handle;
+    }
+    void Erase(HandleType handle) {
+        if (!IsValid(handle)) {
+            std::cout << "ERROR: SlotMap: Destroying an invalid handle: " << handle.value << std::endl;
+            DEBUG_BREAK;
+            return;
+        }
+        Slot& slot = slots[handle.Index()];
+        slot.data = T();
+        slot.occupied = false;
+        // Generation 0 is skipped, so that no handle has the value 0.
+        slot.generation = (slot.generation + 1) & HandleType::generationMask;
+        slot.generation = slot.generation ? slot.generation : 1;
+        freeIndices.push_back(handle.Index());
+    }
+    bool IsValid(HandleType handle) const {
+        return handle.Index() < slots.size() && slots[handle.Index()].occupied && slots[handle.Index()].generation == handle.Generation();
+    }
+    T& operator[](HandleType handle) {
+        Check(handle);
+        return slots[handle.Index()].data;
+    }
+    const T& operator[](HandleType handle) const {
+        Check(handle);
+        return slots[handle.Index()].data;
+    }
+    // Calls func(handle, data) for every element.
+    template <typename Func>
+    void ForEach(Func func) {
+        for (uint32_t index = 0; index < static_cast<uint32_t>(slots.size()); index++) {
+            if (slots[index].occupied) {
+                HandleType handle;
+                handle.value = (slots[index].generation << HandleType::indexBits) | index;
+                func(handle, slots[index].data);
+            }
+        }
+    }
+
+private:
+    void Check(HandleType handle) const {
+#if !defined(NDEBUG)
+        if (!IsValid(handle)) {
+            std::cout << "ERROR: SlotMap: Use of a destroyed or invalid handle: " << handle.value << std::endl;
+            DEBUG_BREAK;
+        }
+#endif
+    }
+
+    struct Slot {
+        T data{};
+        uint32_t generation = 1;
+        bool occupied = false;
+    };
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeIndices;
+};
+
 class GraphicsAPI {
 public:
+    // Typed handles for the resources that all backends keep in SlotMaps.
+    struct BufferTag;
+    struct PipelineTag;
+    typedef Handle<BufferTag> BufferHandle;
+    typedef Handle<PipelineTag> PipelineHandle;
+
 // Pipeline Helpers
 #pragma region Pipeline Helpers
     enum class SwapchainType : uint8_t {
@@ -139,6 +293,10 @@ public:
         UVEC3,
         UVEC4
     };
+    enum class VertexInputRate : uint8_t {
+        VERTEX,
+        INSTANCE
+    };
     enum class PrimitiveTopology : uint8_t {
         POINT_LIST = 0,
         LINE_LIST = 1,
@@ -270,6 +428,7 @@ public:
         uint32_t bindingIndex;  // Which buffer to use when bound for draws.
         size_t offset;
         size_t stride;
+        VertexInputRate inputRate;  // Whether the buffer advances per vertex or per instance. Defaults to VERTEX.
     };
     typedef std::vector<VertexInputBinding> VertexInputBindings;
     struct VertexInputState {
@@ -320,7 +479,7 @@ public:
 
     struct DescriptorInfo {
         uint32_t bindingIndex;
-        void* resource;
+        void* resource;  // BufferHandle::ToPointer() for BUFFER, otherwise the image view or sampler.
         enum class Type : uint8_t {
             BUFFER,
             IMAGE,
@@ -337,6 +496,19 @@ public:
         bool readWrite;
         size_t bufferOffset;
         size_t bufferSize;
+        // The descriptor set, grouped by how often the descriptors change, e.g. 0 per frame, 1 per material and 2 per draw.
+        // Binding indices are unique across the sets, as OpenGL and D3D have a single, flat binding space.
+        uint32_t set = 0;
+    };
+    // Small per-draw data that is set with SetPushConstants() rather than through a buffer and a descriptor. All the ranges of a
+    // pipeline share one block of at most maxPushConstantsSize bytes. Shaders declare it with layout(push_constant) in Vulkan GLSL,
+    // as a uniform block at binding pushConstantsBindingIndex in OpenGL GLSL, and as a cbuffer at that register in HLSL.
+    static constexpr uint32_t maxPushConstantsSize = 128;
+    static constexpr uint32_t pushConstantsBindingIndex = 13;
+    struct PushConstantRange {
+        DescriptorInfo::Stage stage;
+        uint32_t offset;
+        uint32_t size;
     };
     struct PipelineCreateInfo {
         std::vector<void*> shaders;
@@ -349,6 +521,7 @@ public:
         std::vector<int64_t> colorFormats;
         int64_t depthFormat;
         std::vector<DescriptorInfo> layout;
+        std::vector<PushConstantRange> pushConstantRanges;
     };
 
     struct SwapchainCreateInfo {
@@ -369,6 +542,12 @@ public:
         size_t stride;
         size_t size;
         void* data;
+        // How often the data is written. STATIC data may be placed in memory that the CPU can't access directly.
+        enum class Usage : uint8_t {
+            STATIC,   // Written once, or rarely.
+            DYNAMIC,  // Written occasionally.
+            STREAM    // Written every frame.
+        } usage = Usage::DYNAMIC;
     };
 
     struct ImageCreateInfo {
@@ -462,6 +641,14 @@ public:
         Offset2D offset;
         Extent2D extent;
     };
+    // Same layout as DrawElementsIndirectCommand in OpenGL and VkDrawIndexedIndirectCommand in Vulkan.
+    struct DrawIndexedIndirectCommand {
+        uint32_t indexCount;
+        uint32_t instanceCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t firstInstance;
+    };
 
 public:
     virtual ~GraphicsAPI() = default;
@@ -476,6 +663,7 @@ public:
     virtual void PresentDesktopSwapchainImage(void* swapchain, uint32_t index) = 0;
 
     virtual int64_t GetDepthFormat() = 0;
+    virtual size_t AlignSizeForUniformBuffer(size_t size) { return Align<size_t>(size, 256); }
 
     virtual void* GetGraphicsBinding() = 0;
     virtual XrSwapchainImageBaseHeader* AllocateSwapchainImageData(XrSwapchain swapchain, SwapchainType type, uint32_t count) = 0;
@@ -492,37 +680,69 @@ public:
     virtual void* CreateSampler(const SamplerCreateInfo& samplerCI) = 0;
     virtual void DestroySampler(void*& sampler) = 0;
 
-    virtual void* CreateBuffer(const BufferCreateInfo& bufferCI) = 0;
-    virtual void DestroyBuffer(void*& buffer) {}
+    virtual BufferHandle CreateBuffer(const BufferCreateInfo& bufferCI) = 0;
+    virtual void DestroyBuffer(BufferHandle& buffer) {}
 
     virtual void* CreateShader(const ShaderCreateInfo& shaderCI) = 0;
     virtual void DestroyShader(void*& shader) = 0;
 
-    virtual void* CreatePipeline(const PipelineCreateInfo& pipelineCI) = 0;
-    virtual void DestroyPipeline(void*& pipeline) = 0;
+    virtual PipelineHandle CreatePipeline(const PipelineCreateInfo& pipelineCI) = 0;
+    virtual void DestroyPipeline(PipelineHandle& pipeline) = 0;
+
+    // Optional frame-scoped recording. Every BeginRendering()/EndRendering() pair between BeginFrame() and EndFrame() is recorded together and submitted once by EndFrame().
+    // Call EndFrame() before releasing the swapchain images used in the frame.
+    virtual void BeginFrame() {}
+    virtual void EndFrame() {}
 
     virtual void BeginRendering() = 0;
     virtual void EndRendering() = 0;
 
-    virtual void SetBufferData(void* buffer, size_t offset, size_t size, void* data) = 0;
+    // STATIC buffers can only be updated outside of BeginRendering()/EndRendering() and BeginFrame()/EndFrame().
+    virtual void SetBufferData(BufferHandle buffer, size_t offset, size_t size, void* data) = 0;
+    // Copies data into transient uniform buffer memory that lives until the next BeginRendering() and returns the buffer and aligned offset to bind.
+    // Returns an empty handle if the API doesn't provide transient uniform buffer memory. Use SetBufferData() on an application owned buffer instead.
+    virtual BufferHandle AllocateUniformBufferData(size_t size, void* data, size_t& offset) { return BufferHandle(); }
 
     virtual void ClearColor(void* imageView, float r, float g, float b, float a) = 0;
     virtual void ClearDepth(void* imageView, float d) = 0;
+    // Whether the contents of the depth attachment are needed after rendering, e.g. because they're submitted to the compositor.
+    virtual void SetStoreDepthAttachment(bool store) {}
 
-    virtual void SetRenderAttachments(void** colorViews, size_t colorViewCount, void* depthStencilView, uint32_t width, uint32_t height, void* pipeline) = 0;
+    virtual void SetRenderAttachments(void** colorViews, size_t colorViewCount, void* depthStencilView, uint32_t width, uint32_t height, PipelineHandle pipeline) = 0;
     virtual void SetViewports(Viewport* viewports, size_t count) = 0;
     virtual void SetScissors(Rect2D* scissors, size_t count) = 0;
 
-    virtual void SetPipeline(void* pipeline) = 0;
+    virtual void SetPipeline(PipelineHandle pipeline) = 0;
     virtual void SetDescriptor(const DescriptorInfo& descriptorInfo) = 0;
+    // Binds the descriptor sets that SetDescriptor() was called for since the last update. Other sets keep their descriptors, also
+    // across pipelines with different layouts, until a resource is destroyed. Then all of the sets must be set again.
     virtual void UpdateDescriptors() = 0;
-    virtual void SetVertexBuffers(void** vertexBuffers, size_t count) = 0;
-    virtual void SetIndexBuffer(void* indexBuffer) = 0;
+    // Writes size bytes at offset into the push constants of the current pipeline. offset and size are multiples of 4, and stage is
+    // the stage of the range that they fall in. The values are kept until they're overwritten, and are read by the following draws.
+    virtual void SetPushConstants(DescriptorInfo::Stage stage, uint32_t offset, uint32_t size, const void* data) = 0;
+    virtual void SetVertexBuffers(BufferHandle* vertexBuffers, size_t count) = 0;
+    virtual void SetIndexBuffer(BufferHandle indexBuffer) = 0;
     virtual void DrawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t firstInstance = 0) = 0;
     virtual void Draw(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0) = 0;
 
+    // Whether MultiDrawIndexedIndirect() is submitted as a single draw call. Either way, per-instance vertex attributes start at each command's firstInstance.
+    virtual bool IsMultiDrawIndexedIndirectSupported() { return false; }
+    // Submits drawCount indexed draws with the current pipeline, descriptors and buffers. Falls back to one DrawIndexed() per command.
+    virtual void MultiDrawIndexedIndirect(const DrawIndexedIndirectCommand* commands, uint32_t drawCount) {
+        for (uint32_t i = 0; i < drawCount; i++) {
+            DrawIndexed(commands[i].indexCount, commands[i].instanceCount, commands[i].firstIndex, commands[i].vertexOffset, commands[i].firstInstance);
+        }
+    }
+
 protected:
     virtual const std::vector<int64_t> GetSupportedColorSwapchainFormats() = 0;
     virtual const std::vector<int64_t> GetSupportedDepthSwapchainFormats() = 0;
     bool debugAPI = false;
 };
+
+// Maps a GraphicsAPI_Type to its backend class. Each backend header specializes this for its type, and the backend classes are final,
+// so calls through GraphicsAPI_Backend<type>::Type are bound at compile time and can be inlined. Types without a backend map to GraphicsAPI.
+template <GraphicsAPI_Type type>
+struct GraphicsAPI_Backend {
+    typedef GraphicsAPI Type;
+};
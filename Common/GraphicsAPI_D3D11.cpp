@@ -223,6 +223,7 @@ GraphicsAPI_D3D11::GraphicsAPI_D3D11(XrInstance m_xrInstance, XrSystemId systemI
 }
 
 GraphicsAPI_D3D11::~GraphicsAPI_D3D11() {
+    D3D11_SAFE_RELEASE(pushConstantsBuffer);
     D3D11_SAFE_RELEASE(immediateContext);
     D3D11_SAFE_RELEASE(device);
     D3D11_SAFE_RELEASE(factory);
@@ -560,7 +561,7 @@ void GraphicsAPI_D3D11::DestroySampler(void *&sampler) {
     sampler = nullptr;
 }
 
-void *GraphicsAPI_D3D11::CreateBuffer(const BufferCreateInfo &bufferCI) {
+GraphicsAPI::BufferHandle GraphicsAPI_D3D11::CreateBuffer(const BufferCreateInfo &bufferCI) {
     D3D11_SUBRESOURCE_DATA initData{};
     initData.pSysMem = bufferCI.data;
     initData.SysMemPitch = (UINT)bufferCI.stride;
@@ -579,16 +580,16 @@ void *GraphicsAPI_D3D11::CreateBuffer(const BufferCreateInfo &bufferCI) {
     ID3D11Buffer *d3D11Buffer = nullptr;
     D3D11_CHECK(device->CreateBuffer(&desc, bufferCI.data ? &initData : nullptr, &d3D11Buffer), "Failed to create Buffer");
     
-    SetBufferData(d3D11Buffer, 0, bufferCI.size, bufferCI.data);
-    buffers[d3D11Buffer] = bufferCI;
-   
-    return d3D11Buffer;
+    WriteBufferData(d3D11Buffer, 0, bufferCI.size, bufferCI.data);
+
+    return buffers.Insert({d3D11Buffer, bufferCI});
 }
 
-void GraphicsAPI_D3D11::DestroyBuffer(void *&buffer) {
-    ID3D11Buffer *d3D11Buffer = reinterpret_cast<ID3D11Buffer *>(buffer);
-    buffers.erase(d3D11Buffer);
+void GraphicsAPI_D3D11::DestroyBuffer(BufferHandle &buffer) {
+    ID3D11Buffer *d3D11Buffer = buffers[buffer].buffer;
+    buffers.Erase(buffer);
     D3D11_SAFE_RELEASE(d3D11Buffer);
+    buffer = BufferHandle();
 }
 
 void *GraphicsAPI_D3D11::CreateShader(const ShaderCreateInfo &shaderCI) {
@@ -644,16 +645,13 @@ void GraphicsAPI_D3D11::DestroyShader(void *&shader) {
     shader = nullptr;
 }
 
-void *GraphicsAPI_D3D11::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
-    static UINT64 pipelineID = 0;
-    pipelineID++;
-    pipelines[pipelineID] = pipelineCI;
-    return (void *)pipelineID;
+GraphicsAPI::PipelineHandle GraphicsAPI_D3D11::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
+    return pipelines.Insert(pipelineCI);
 }
 
-void GraphicsAPI_D3D11::DestroyPipeline(void *&pipeline) {
-    pipelines.erase((UINT64)pipeline);
-    pipeline = nullptr;
+void GraphicsAPI_D3D11::DestroyPipeline(PipelineHandle &pipeline) {
+    pipelines.Erase(pipeline);
+    pipeline = PipelineHandle();
 }
 
 void GraphicsAPI_D3D11::BeginRendering() {
@@ -662,8 +660,11 @@ void GraphicsAPI_D3D11::BeginRendering() {
 void GraphicsAPI_D3D11::EndRendering() {
 }
 
-void GraphicsAPI_D3D11::SetBufferData(void *buffer, size_t offset, size_t size, void *data) {
-    ID3D11Buffer *d3d11Buffer = (ID3D11Buffer *)buffer;
+void GraphicsAPI_D3D11::SetBufferData(BufferHandle buffer, size_t offset, size_t size, void *data) {
+    WriteBufferData(buffers[buffer].buffer, offset, size, data);
+}
+
+void GraphicsAPI_D3D11::WriteBufferData(ID3D11Buffer *d3d11Buffer, size_t offset, size_t size, const void *data) {
     D3D11_MAPPED_SUBRESOURCE mappedSubresource = {};
     D3D11_CHECK(immediateContext->Map(d3d11Buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedSubresource), "Failed to map Resource.");
     if (mappedSubresource.pData && data)
@@ -680,7 +681,7 @@ void GraphicsAPI_D3D11::ClearDepth(void *imageView, float d) {
     immediateContext->ClearDepthStencilView((ID3D11DepthStencilView *)imageView, D3D11_CLEAR_DEPTH, d, 0);
 }
 
-void GraphicsAPI_D3D11::SetRenderAttachments(void **colorViews, size_t colorViewCount, void *depthStencilView, uint32_t width, uint32_t height, void *pipeline) {
+void GraphicsAPI_D3D11::SetRenderAttachments(void **colorViews, size_t colorViewCount, void *depthStencilView, uint32_t width, uint32_t height, PipelineHandle pipeline) {
     immediateContext->OMSetRenderTargets((UINT)colorViewCount, (ID3D11RenderTargetView *const *)colorViews, (ID3D11DepthStencilView *)depthStencilView);
 }
 
@@ -704,9 +705,11 @@ void GraphicsAPI_D3D11::SetScissors(Rect2D *scissors, size_t count) {
     immediateContext->RSSetScissorRects(static_cast<UINT>(d3d11Scissors.size()), d3d11Scissors.data());
 }
 
-void GraphicsAPI_D3D11::SetPipeline(void *pipeline) {
-    PipelineCreateInfo pipelineCI = pipelines[(UINT64)pipeline];
-    setPipeline = (UINT64)pipeline;
+void GraphicsAPI_D3D11::SetPipeline(PipelineHandle pipeline) {
+    const PipelineCreateInfo &pipelineCI = pipelines[pipeline];
+    setPipeline = pipeline;
+    // The push constants buffer is bound to the stages of the pipeline's ranges at the next draw.
+    pushConstantsDirty |= !pipelineCI.pushConstantRanges.empty();
 
     // Shaders
     for (void *shader : pipelineCI.shaders) {
@@ -767,6 +770,12 @@ void GraphicsAPI_D3D11::SetPipeline(void *pipeline) {
             element.AlignedByteOffset = (UINT)attribute.offset;
             element.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
             element.InstanceDataStepRate = 0;
+            for (const VertexInputBinding &binding : pipelineCI.vertexInputState.bindings) {
+                if (binding.bindingIndex == attribute.bindingIndex && binding.inputRate == VertexInputRate::INSTANCE) {
+                    element.InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+                    element.InstanceDataStepRate = 1;
+                }
+            }
             elements.push_back(element);
         }
 
@@ -872,17 +881,23 @@ void GraphicsAPI_D3D11::SetDescriptor(const DescriptorInfo &descriptorInfo) {
     ID3D11DeviceContext1 *immediateContext1 = nullptr;
     D3D11_CHECK(immediateContext->QueryInterface(IID_PPV_ARGS(&immediateContext1)), "Failed to get ID3D11DeviceContext1 * from Immediate Context.");
 
+    // BUFFER descriptors carry a BufferHandle, so resolve it to the ID3D11Buffer.
+    void *resource = descriptorInfo.resource;
+    if (descriptorInfo.type == DescriptorInfo::Type::BUFFER) {
+        resource = buffers[BufferHandle::FromPointer(descriptorInfo.resource)].buffer;
+    }
+
     UINT slot = descriptorInfo.bindingIndex;
     UINT firstConstant = Align<UINT>(descriptorInfo.bufferOffset / 16, 16);
     UINT numConstants = Align<UINT>(descriptorInfo.bufferSize / 16, 16);
     switch (descriptorInfo.stage) {
     case DescriptorInfo::Stage::VERTEX: {
         if (descriptorInfo.type == DescriptorInfo::Type::BUFFER) {
-            immediateContext1->VSSetConstantBuffers1(slot, 1, (ID3D11Buffer *const *)&descriptorInfo.resource, &firstConstant, &numConstants);
+            immediateContext1->VSSetConstantBuffers1(slot, 1, (ID3D11Buffer *const *)&resource, &firstConstant, &numConstants);
         } else if (descriptorInfo.type == DescriptorInfo::Type::IMAGE) {
-            immediateContext1->VSSetShaderResources(slot, 1, (ID3D11ShaderResourceView *const *)&descriptorInfo.resource);
+            immediateContext1->VSSetShaderResources(slot, 1, (ID3D11ShaderResourceView *const *)&resource);
         } else if (descriptorInfo.type == DescriptorInfo::Type::SAMPLER) {
-            immediateContext1->VSSetSamplers(slot, 1, (ID3D11SamplerState *const *)&descriptorInfo.resource);
+            immediateContext1->VSSetSamplers(slot, 1, (ID3D11SamplerState *const *)&resource);
         } else {
             std::cout << "ERROR: D3D11: Unknown Descriptor Type." << std::endl;
         }
@@ -890,11 +905,11 @@ void GraphicsAPI_D3D11::SetDescriptor(const DescriptorInfo &descriptorInfo) {
     }
     case DescriptorInfo::Stage::TESSELLATION_CONTROL: {
         if (descriptorInfo.type == DescriptorInfo::Type::BUFFER) {
-            immediateContext1->HSSetConstantBuffers1(slot, 1, (ID3D11Buffer *const *)&descriptorInfo.resource, &firstConstant, &numConstants);
+            immediateContext1->HSSetConstantBuffers1(slot, 1, (ID3D11Buffer *const *)&resource, &firstConstant, &numConstants);
         } else if (descriptorInfo.type == DescriptorInfo::Type::IMAGE) {
-            immediateContext1->HSSetShaderResources(slot, 1, (ID3D11ShaderResourceView *const *)&descriptorInfo.resource);
+            immediateContext1->HSSetShaderResources(slot, 1, (ID3D11ShaderResourceView *const *)&resource);
         } else if (descriptorInfo.type == DescriptorInfo::Type::SAMPLER) {
-            immediateContext1->HSSetSamplers(slot, 1, (ID3D11SamplerState *const *)&descriptorInfo.resource);
+            immediateContext1->HSSetSamplers(slot, 1, (ID3D11SamplerState *const *)&resource);
         } else {
             std::cout << "ERROR: D3D11: Unknown Descriptor Type." << std::endl;
         }
@@ -902,11 +917,11 @@ void GraphicsAPI_D3D11::SetDescriptor(const DescriptorInfo &descriptorInfo) {
     }
     case DescriptorInfo::Stage::TESSELLATION_EVALUATION: {
         if (descriptorInfo.type == DescriptorInfo::Type::BUFFER) {
-            immediateContext1->DSSetConstantBuffers1(slot, 1, (ID3D11Buffer *const *)&descriptorInfo.resource, &firstConstant, &numConstants);
+            immediateContext1->DSSetConstantBuffers1(slot, 1, (ID3D11Buffer *const *)&resource, &firstConstant, &numConstants);
         } else if (descriptorInfo.type == DescriptorInfo::Type::IMAGE) {
-            immediateContext1->DSSetShaderResources(slot, 1, (ID3D11ShaderResourceView *const *)&descriptorInfo.resource);
+            immediateContext1->DSSetShaderResources(slot, 1, (ID3D11ShaderResourceView *const *)&resource);
         } else if (descriptorInfo.type == DescriptorInfo::Type::SAMPLER) {
-            immediateContext1->DSSetSamplers(slot, 1, (ID3D11SamplerState *const *)&descriptorInfo.resource);
+            immediateContext1->DSSetSamplers(slot, 1, (ID3D11SamplerState *const *)&resource);
         } else {
             std::cout << "ERROR: D3D11: Unknown Descriptor Type." << std::endl;
         }
@@ -914,11 +929,11 @@ void GraphicsAPI_D3D11::SetDescriptor(const DescriptorInfo &descriptorInfo) {
     }
     case DescriptorInfo::Stage::GEOMETRY: {
         if (descriptorInfo.type == DescriptorInfo::Type::BUFFER) {
-            immediateContext1->GSSetConstantBuffers1(slot, 1, (ID3D11Buffer *const *)&descriptorInfo.resource, &firstConstant, &numConstants);
+            immediateContext1->GSSetConstantBuffers1(slot, 1, (ID3D11Buffer *const *)&resource, &firstConstant, &numConstants);
         } else if (descriptorInfo.type == DescriptorInfo::Type::IMAGE) {
-            immediateContext1->GSSetShaderResources(slot, 1, (ID3D11ShaderResourceView *const *)&descriptorInfo.resource);
+            immediateContext1->GSSetShaderResources(slot, 1, (ID3D11ShaderResourceView *const *)&resource);
         } else if (descriptorInfo.type == DescriptorInfo::Type::SAMPLER) {
-            immediateContext1->GSSetSamplers(slot, 1, (ID3D11SamplerState *const *)&descriptorInfo.resource);
+            immediateContext1->GSSetSamplers(slot, 1, (ID3D11SamplerState *const *)&resource);
         } else {
             std::cout << "ERROR: D3D11: Unknown Descriptor Type." << std::endl;
         }
@@ -926,11 +941,11 @@ void GraphicsAPI_D3D11::SetDescriptor(const DescriptorInfo &descriptorInfo) {
     }
     case DescriptorInfo::Stage::FRAGMENT: {
         if (descriptorInfo.type == DescriptorInfo::Type::BUFFER) {
-            immediateContext1->PSSetConstantBuffers1(slot, 1, (ID3D11Buffer *const *)&descriptorInfo.resource, &firstConstant, &numConstants);
+            immediateContext1->PSSetConstantBuffers1(slot, 1, (ID3D11Buffer *const *)&resource, &firstConstant, &numConstants);
         } else if (descriptorInfo.type == DescriptorInfo::Type::IMAGE) {
-            immediateContext1->PSSetShaderResources(slot, 1, (ID3D11ShaderResourceView *const *)&descriptorInfo.resource);
+            immediateContext1->PSSetShaderResources(slot, 1, (ID3D11ShaderResourceView *const *)&resource);
         } else if (descriptorInfo.type == DescriptorInfo::Type::SAMPLER) {
-            immediateContext1->PSSetSamplers(slot, 1, (ID3D11SamplerState *const *)&descriptorInfo.resource);
+            immediateContext1->PSSetSamplers(slot, 1, (ID3D11SamplerState *const *)&resource);
         } else {
             std::cout << "ERROR: D3D11: Unknown Descriptor Type." << std::endl;
         }
@@ -941,16 +956,16 @@ void GraphicsAPI_D3D11::SetDescriptor(const DescriptorInfo &descriptorInfo) {
             if (descriptorInfo.readWrite) {
                 // UAVs?
             } else {
-                immediateContext1->CSSetConstantBuffers1(slot, 1, (ID3D11Buffer *const *)&descriptorInfo.resource, &firstConstant, &numConstants);
+                immediateContext1->CSSetConstantBuffers1(slot, 1, (ID3D11Buffer *const *)&resource, &firstConstant, &numConstants);
             }
         } else if (descriptorInfo.type == DescriptorInfo::Type::IMAGE) {
             if (descriptorInfo.readWrite) {
-                immediateContext1->CSSetUnorderedAccessViews(slot, 1, (ID3D11UnorderedAccessView *const *)&descriptorInfo.resource, nullptr);
+                immediateContext1->CSSetUnorderedAccessViews(slot, 1, (ID3D11UnorderedAccessView *const *)&resource, nullptr);
             } else {
-                immediateContext1->CSSetShaderResources(slot, 1, (ID3D11ShaderResourceView *const *)&descriptorInfo.resource);
+                immediateContext1->CSSetShaderResources(slot, 1, (ID3D11ShaderResourceView *const *)&resource);
             }
         } else if (descriptorInfo.type == DescriptorInfo::Type::SAMPLER) {
-            immediateContext1->CSSetSamplers(slot, 1, (ID3D11SamplerState *const *)&descriptorInfo.resource);
+            immediateContext1->CSSetSamplers(slot, 1, (ID3D11SamplerState *const *)&resource);
         } else {
             std::cout << "ERROR: D3D11: Unknown Descriptor Type." << std::endl;
         }
@@ -966,11 +981,66 @@ void GraphicsAPI_D3D11::SetDescriptor(const DescriptorInfo &descriptorInfo) {
 void GraphicsAPI_D3D11::UpdateDescriptors() {
 }
 
-void GraphicsAPI_D3D11::SetVertexBuffers(void **vertexBuffers, size_t count) {
+void GraphicsAPI_D3D11::SetPushConstants(DescriptorInfo::Stage stage, uint32_t offset, uint32_t size, const void *data) {
+    if (offset + size > maxPushConstantsSize) {
+        std::cout << "ERROR: D3D11: Push constants exceed " << maxPushConstantsSize << " bytes." << std::endl;
+        DEBUG_BREAK;
+        return;
+    }
+    memcpy(pushConstantsData + offset, data, size);
+    pushConstantsDirty = true;
+}
+
+void GraphicsAPI_D3D11::FlushPushConstants() {
+    if (!pushConstantsDirty) {
+        return;
+    }
+    pushConstantsDirty = false;
+
+    if (!pushConstantsBuffer) {
+        D3D11_BUFFER_DESC desc{};
+        desc.ByteWidth = (UINT)maxPushConstantsSize;
+        desc.Usage = D3D11_USAGE_DYNAMIC;
+        desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        D3D11_CHECK(device->CreateBuffer(&desc, nullptr, &pushConstantsBuffer), "Failed to create Buffer");
+    }
+    WriteBufferData(pushConstantsBuffer, 0, maxPushConstantsSize, pushConstantsData);
+
+    const UINT slot = pushConstantsBindingIndex;
+    for (const PushConstantRange &pushConstantRange : pipelines[setPipeline].pushConstantRanges) {
+        switch (pushConstantRange.stage) {
+        case DescriptorInfo::Stage::VERTEX:
+            immediateContext->VSSetConstantBuffers(slot, 1, &pushConstantsBuffer);
+            break;
+        case DescriptorInfo::Stage::TESSELLATION_CONTROL:
+            immediateContext->HSSetConstantBuffers(slot, 1, &pushConstantsBuffer);
+            break;
+        case DescriptorInfo::Stage::TESSELLATION_EVALUATION:
+            immediateContext->DSSetConstantBuffers(slot, 1, &pushConstantsBuffer);
+            break;
+        case DescriptorInfo::Stage::GEOMETRY:
+            immediateContext->GSSetConstantBuffers(slot, 1, &pushConstantsBuffer);
+            break;
+        case DescriptorInfo::Stage::FRAGMENT:
+            immediateContext->PSSetConstantBuffers(slot, 1, &pushConstantsBuffer);
+            break;
+        case DescriptorInfo::Stage::COMPUTE:
+            immediateContext->CSSetConstantBuffers(slot, 1, &pushConstantsBuffer);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void GraphicsAPI_D3D11::SetVertexBuffers(BufferHandle *vertexBuffers, size_t count) {
     const VertexInputState &vertexInputState = pipelines[setPipeline].vertexInputState;
+    std::vector<ID3D11Buffer *> d3d11Buffers;
     std::vector<UINT> strides;
     std::vector<UINT> offsets;
     for (size_t i = 0; i < count; i++) {
+        d3d11Buffers.push_back(buffers[vertexBuffers[i]].buffer);
         for (const VertexInputBinding &vertexBinding : vertexInputState.bindings) {
             if (vertexBinding.bindingIndex == (uint32_t)i) {
                 strides.push_back((UINT)vertexBinding.stride);
@@ -978,20 +1048,22 @@ void GraphicsAPI_D3D11::SetVertexBuffers(void **vertexBuffers, size_t count) {
             }
         }
     }
-    immediateContext->IASetVertexBuffers(0, (UINT)count, (ID3D11Buffer *const *)vertexBuffers, strides.data(), offsets.data());
+    immediateContext->IASetVertexBuffers(0, (UINT)count, d3d11Buffers.data(), strides.data(), offsets.data());
 }
 
-void GraphicsAPI_D3D11::SetIndexBuffer(void *indexBuffer) {
-    ID3D11Buffer *d3d11IndexBuffer = (ID3D11Buffer *)indexBuffer;
-    const BufferCreateInfo &bufferCI = buffers[d3d11IndexBuffer];
-    immediateContext->IASetIndexBuffer(d3d11IndexBuffer, bufferCI.stride == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, 0);
+void GraphicsAPI_D3D11::SetIndexBuffer(BufferHandle indexBuffer) {
+    const BufferResource &bufferResource = buffers[indexBuffer];
+    const BufferCreateInfo &bufferCI = bufferResource.bufferCI;
+    immediateContext->IASetIndexBuffer(bufferResource.buffer, bufferCI.stride == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, 0);
 }
 
 void GraphicsAPI_D3D11::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) {
+    FlushPushConstants();
     immediateContext->DrawIndexedInstanced(indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
 }
 
 void GraphicsAPI_D3D11::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) {
+    FlushPushConstants();
     immediateContext->DrawInstanced(vertexCount, instanceCount, firstVertex, firstInstance);
 }
 
@@ -8,7 +8,7 @@
 #include <GraphicsAPI.h>
 
 #if defined(XR_USE_GRAPHICS_API_D3D11)
-class GraphicsAPI_D3D11 : public GraphicsAPI {
+class GraphicsAPI_D3D11 final : public GraphicsAPI {
 public:
     GraphicsAPI_D3D11();
     GraphicsAPI_D3D11(XrInstance m_xrInstance, XrSystemId systemId);
@@ -44,32 +44,33 @@ public:
     virtual void* CreateSampler(const SamplerCreateInfo& samplerCI) override;
     virtual void DestroySampler(void*& sampler) override;
 
-    virtual void* CreateBuffer(const BufferCreateInfo& bufferCI) override;
-    virtual void DestroyBuffer(void*& buffer) override;
+    virtual BufferHandle CreateBuffer(const BufferCreateInfo& bufferCI) override;
+    virtual void DestroyBuffer(BufferHandle& buffer) override;
 
     virtual void* CreateShader(const ShaderCreateInfo& shaderCI) override;
     virtual void DestroyShader(void*& shader) override;
 
-    virtual void* CreatePipeline(const PipelineCreateInfo& pipelineCI) override;
-    virtual void DestroyPipeline(void*& pipeline) override;
+    virtual PipelineHandle CreatePipeline(const PipelineCreateInfo& pipelineCI) override;
+    virtual void DestroyPipeline(PipelineHandle& pipeline) override;
 
     virtual void BeginRendering() override;
     virtual void EndRendering() override;
 
-    virtual void SetBufferData(void* buffer, size_t offset, size_t size, void* data) override;
+    virtual void SetBufferData(BufferHandle buffer, size_t offset, size_t size, void* data) override;
 
     virtual void ClearColor(void* image, float r, float g, float b, float a) override;
     virtual void ClearDepth(void* image, float d) override;
 
-    virtual void SetRenderAttachments(void** colorViews, size_t colorViewCount, void* depthStencilView, uint32_t width, uint32_t height, void* pipeline) override;
+    virtual void SetRenderAttachments(void** colorViews, size_t colorViewCount, void* depthStencilView, uint32_t width, uint32_t height, PipelineHandle pipeline) override;
     virtual void SetViewports(Viewport* viewports, size_t count) override;
     virtual void SetScissors(Rect2D* scissors, size_t count) override;
 
-    virtual void SetPipeline(void* pipeline) override;
+    virtual void SetPipeline(PipelineHandle pipeline) override;
     virtual void SetDescriptor(const DescriptorInfo& descriptorInfo) override;
     virtual void UpdateDescriptors() override;
-    virtual void SetVertexBuffers(void** vertexBuffers, size_t count) override;
-    virtual void SetIndexBuffer(void* indexBuffer) override;
+    virtual void SetPushConstants(DescriptorInfo::Stage stage, uint32_t offset, uint32_t size, const void* data) override;
+    virtual void SetVertexBuffers(BufferHandle* vertexBuffers, size_t count) override;
+    virtual void SetIndexBuffer(BufferHandle indexBuffer) override;
     virtual void DrawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t firstInstance = 0) override;
     virtual void Draw(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0) override;
 
@@ -77,6 +78,10 @@ private:
     virtual const std::vector<int64_t> GetSupportedColorSwapchainFormats() override;
     virtual const std::vector<int64_t> GetSupportedDepthSwapchainFormats() override;
 
+private:
+    void WriteBufferData(ID3D11Buffer* buffer, size_t offset, size_t size, const void* data);
+    void FlushPushConstants();
+
 private:
     IDXGIFactory4* factory = nullptr;
     ID3D11Device* device = nullptr;
@@ -90,10 +95,26 @@ private:
 
     std::unordered_map<XrSwapchain, std::pair<SwapchainType, std::vector<XrSwapchainImageD3D11KHR>>> swapchainImagesMap{};
 
-    std::unordered_map<ID3D11Buffer*, BufferCreateInfo> buffers;
+    // Buffers and pipelines are looked up on every draw, so they're kept in SlotMaps.
+    struct BufferResource {
+        ID3D11Buffer* buffer = nullptr;
+        BufferCreateInfo bufferCI;
+    };
+    SlotMap<BufferResource, BufferTag> buffers;
 
     std::unordered_map<ID3D11DeviceChild*, std::vector<char>> shaderCompiledBinaries;
-    std::unordered_map<UINT64, PipelineCreateInfo> pipelines;
-    UINT64 setPipeline = 0;
+    SlotMap<PipelineCreateInfo, PipelineTag> pipelines;
+    PipelineHandle setPipeline;
+
+    // Push constants are emulated with a dynamic constant buffer at register pushConstantsBindingIndex, which is rewritten with
+    // D3D11_MAP_WRITE_DISCARD before each draw that follows a change.
+    uint8_t pushConstantsData[maxPushConstantsSize] = {};
+    bool pushConstantsDirty = false;
+    ID3D11Buffer* pushConstantsBuffer = nullptr;
+};
+
+template <>
+struct GraphicsAPI_Backend<D3D11> {
+    typedef GraphicsAPI_D3D11 Type;
 };
 #endif
\ No newline at end of file
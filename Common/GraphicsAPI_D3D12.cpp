@@ -697,7 +697,7 @@ void GraphicsAPI_D3D12::DestroySampler(void *&sampler) {
     sampler = nullptr;
 }
 
-void *GraphicsAPI_D3D12::CreateBuffer(const BufferCreateInfo &bufferCI) {
+GraphicsAPI::BufferHandle GraphicsAPI_D3D12::CreateBuffer(const BufferCreateInfo &bufferCI) {
     ID3D12Resource *buffer = nullptr;
 
     size_t size = bufferCI.size;
@@ -743,19 +743,19 @@ void *GraphicsAPI_D3D12::CreateBuffer(const BufferCreateInfo &bufferCI) {
 
     D3D12_CHECK(device->CreatePlacedResource(heap, 0, &desc, initState, clear, IID_PPV_ARGS(&buffer)), "Failed to create Buffer.");
 
-    SetBufferData(buffer, 0, bufferCI.size, bufferCI.data);
-    bufferResources[buffer] = {heap, bufferCI};
+    BufferHandle bufferHandle = bufferResources.Insert({buffer, heap, bufferCI});
+    SetBufferData(bufferHandle, 0, bufferCI.size, bufferCI.data);
 
-    return buffer;
+    return bufferHandle;
 }
 
-void GraphicsAPI_D3D12::DestroyBuffer(void *&buffer) {
-    ID3D12Resource *d3d12Buffer = reinterpret_cast<ID3D12Resource *>(buffer);
-    ID3D12Heap *heap = bufferResources[d3d12Buffer].first;
-    bufferResources.erase(d3d12Buffer);
+void GraphicsAPI_D3D12::DestroyBuffer(BufferHandle &buffer) {
+    ID3D12Resource *d3d12Buffer = bufferResources[buffer].buffer;
+    ID3D12Heap *heap = bufferResources[buffer].heap;
+    bufferResources.Erase(buffer);
     D3D12_SAFE_RELEASE(heap);
     D3D12_SAFE_RELEASE(d3d12Buffer);
-    buffer = nullptr;
+    buffer = BufferHandle();
 }
 
 void *GraphicsAPI_D3D12::CreateShader(const ShaderCreateInfo &shaderCI) {
@@ -778,7 +778,7 @@ void GraphicsAPI_D3D12::DestroyShader(void *&shader) {
     shader = nullptr;
 }
 
-void *GraphicsAPI_D3D12::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
+GraphicsAPI::PipelineHandle GraphicsAPI_D3D12::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
     D3D12_GRAPHICS_PIPELINE_STATE_DESC GPSD = {};
 
     // ShaderStages
@@ -818,6 +818,12 @@ void *GraphicsAPI_D3D12::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
         il.AlignedByteOffset = attrib.offset;
         il.InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
         il.InstanceDataStepRate = 0;
+        for (auto &binding : pipelineCI.vertexInputState.bindings) {
+            if (binding.bindingIndex == attrib.bindingIndex && binding.inputRate == VertexInputRate::INSTANCE) {
+                il.InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA;
+                il.InstanceDataStepRate = 1;
+            }
+        }
         inputLayout.push_back(il);
     }
     GPSD.InputLayout = {inputLayout.data(), (UINT)inputLayout.size()};
@@ -952,6 +958,15 @@ void *GraphicsAPI_D3D12::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
         descriptorRange.BaseShaderRegister = descInfo.bindingIndex;
         descriptorRange.RegisterSpace = 0;
         descriptorRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+        // The shaders declare their registers in space0, so the sets share one binding space and a binding must be unique across them.
+        for (const D3D12_DESCRIPTOR_RANGE &otherRange : descriptorRanges) {
+            if (otherRange.RangeType == descriptorRange.RangeType && otherRange.BaseShaderRegister == descriptorRange.BaseShaderRegister) {
+                std::cout << "ERROR: D3D12: Binding " << descInfo.bindingIndex << " of set " << descInfo.set << " is already used by another descriptor in the layout." << std::endl;
+                DEBUG_BREAK;
+                return PipelineHandle();
+            }
+        }
         descriptorRanges.push_back(descriptorRange);
     }
 
@@ -968,6 +983,21 @@ void *GraphicsAPI_D3D12::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
         rootParameters.push_back(rootParameter);
     }
 
+    // Push constants are root constants at register pushConstantsBindingIndex, in the root parameter after the descriptor tables.
+    UINT pushConstantsSize = 0;
+    for (const PushConstantRange &pushConstantRange : pipelineCI.pushConstantRanges) {
+        pushConstantsSize = std::max(pushConstantsSize, pushConstantRange.offset + pushConstantRange.size);
+    }
+    if (pushConstantsSize > 0) {
+        D3D12_ROOT_PARAMETER rootParameter;
+        rootParameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        rootParameter.Constants.ShaderRegister = pushConstantsBindingIndex;
+        rootParameter.Constants.RegisterSpace = 0;
+        rootParameter.Constants.Num32BitValues = Align<UINT>(pushConstantsSize, 4) / 4;
+        rootParameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+        rootParameters.push_back(rootParameter);
+    }
+
     rootSignatureDesc.NumParameters = static_cast<UINT>(rootParameters.size());
     rootSignatureDesc.pParameters = rootParameters.data();
     rootSignatureDesc.NumStaticSamplers = 0;
@@ -994,18 +1024,16 @@ void *GraphicsAPI_D3D12::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
     D3D12_SAFE_RELEASE(serializedRootSignature);
     D3D12_SAFE_RELEASE(serializedRootSignatureError);
 
-    pipelineResources[pipeline] = {rootSignature, pipelineCI};
-
-    return pipeline;
+    return pipelineResources.Insert({pipeline, rootSignature, pipelineCI});
 }
 
-void GraphicsAPI_D3D12::DestroyPipeline(void *&pipeline) {
-    ID3D12PipelineState *d3d12Pipeline = reinterpret_cast<ID3D12PipelineState *>(pipeline);
-    ID3D12RootSignature *rootSignature = pipelineResources[d3d12Pipeline].first;
-    pipelineResources.erase(d3d12Pipeline);
+void GraphicsAPI_D3D12::DestroyPipeline(PipelineHandle &pipeline) {
+    ID3D12PipelineState *d3d12Pipeline = pipelineResources[pipeline].pipeline;
+    ID3D12RootSignature *rootSignature = pipelineResources[pipeline].rootSignature;
+    pipelineResources.Erase(pipeline);
     D3D12_SAFE_RELEASE(d3d12Pipeline);
     D3D12_SAFE_RELEASE(rootSignature);
-    pipeline = nullptr;
+    pipeline = PipelineHandle();
 }
 
 void GraphicsAPI_D3D12::BeginRendering() {
@@ -1089,8 +1117,8 @@ void GraphicsAPI_D3D12::ClearDepth(void *imageView, float d) {
     cmdList->ClearDepthStencilView(d3d12ImageView, D3D12_CLEAR_FLAG_DEPTH, d, 0, 0, nullptr);
 }
 
-void GraphicsAPI_D3D12::SetBufferData(void *buffer, size_t offset, size_t size, void *data) {
-    ID3D12Resource *d3d12Buffer = (ID3D12Resource *)buffer;
+void GraphicsAPI_D3D12::SetBufferData(BufferHandle buffer, size_t offset, size_t size, void *data) {
+    ID3D12Resource *d3d12Buffer = bufferResources[buffer].buffer;
     void *mappedData = nullptr;
     D3D12_RANGE readRange = {0, 0};
     D3D12_CHECK(d3d12Buffer->Map(0, &readRange, &mappedData), "Failed to map Resource.");
@@ -1099,7 +1127,7 @@ void GraphicsAPI_D3D12::SetBufferData(void *buffer, size_t offset, size_t size,
     d3d12Buffer->Unmap(0, nullptr);
 }
 
-void GraphicsAPI_D3D12::SetRenderAttachments(void **colorViews, size_t colorViewCount, void *depthStencilView, uint32_t width, uint32_t height, void *pipeline) {
+void GraphicsAPI_D3D12::SetRenderAttachments(void **colorViews, size_t colorViewCount, void *depthStencilView, uint32_t width, uint32_t height, PipelineHandle pipeline) {
     std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> d3d12RTVs;
     d3d12RTVs.reserve(colorViewCount);
     for (size_t i = 0; i < colorViewCount; i++) {
@@ -1132,14 +1160,14 @@ void GraphicsAPI_D3D12::SetScissors(Rect2D *scissors, size_t count) {
     cmdList->RSSetScissorRects(static_cast<UINT>(d3d12Scissors.size()), d3d12Scissors.data());
 }
 
-void GraphicsAPI_D3D12::SetPipeline(void *pipeline) {
-    ID3D12PipelineState *d3d12Pipeline = reinterpret_cast<ID3D12PipelineState *>(pipeline);
-    setPipeline = d3d12Pipeline;
+void GraphicsAPI_D3D12::SetPipeline(PipelineHandle pipeline) {
+    setPipeline = pipeline;
 
-    const PipelineCreateInfo &pipelineCI = pipelineResources[d3d12Pipeline].second;
+    const PipelineResource &pipelineResource = pipelineResources[pipeline];
+    const PipelineCreateInfo &pipelineCI = pipelineResource.pipelineCI;
 
-    cmdList->SetPipelineState(d3d12Pipeline);
-    cmdList->SetGraphicsRootSignature(pipelineResources[d3d12Pipeline].first);
+    cmdList->SetPipelineState(pipelineResource.pipeline);
+    cmdList->SetGraphicsRootSignature(pipelineResource.rootSignature);
     cmdList->IASetPrimitiveTopology(ToD3D12_PRIMITIVE_TOPOLOGY(pipelineCI.inputAssemblyState.topology));
 }
 
@@ -1159,8 +1187,22 @@ void GraphicsAPI_D3D12::UpdateDescriptors() {
     UINT Current_CBV_SRV_UAV_DescriptorOffset = CBV_SRV_UAV_DescriptorOffset;
     UINT Current_SAMPLER_DescriptorOffset = SAMPLER_DescriptorOffset;
 
-    size_t rootParameterIndex = 0;
+    // Each entry of the pipeline's layout has its own descriptor table, so the sets can be updated independently and in any order.
+    const PipelineCreateInfo &pipelineCI = pipelineResources[setPipeline].pipelineCI;
     for (const DescriptorInfo &descriptorInfo : descriptorInfos) {
+        UINT rootParameterIndex = 0;
+        while (rootParameterIndex < pipelineCI.layout.size()) {
+            const DescriptorInfo &layoutInfo = pipelineCI.layout[rootParameterIndex];
+            if (layoutInfo.set == descriptorInfo.set && layoutInfo.bindingIndex == descriptorInfo.bindingIndex && layoutInfo.type == descriptorInfo.type) {
+                break;
+            }
+            rootParameterIndex++;
+        }
+        if (rootParameterIndex == pipelineCI.layout.size()) {
+            std::cout << "ERROR: D3D12: Descriptor " << descriptorInfo.bindingIndex << " of set " << descriptorInfo.set << " isn't in the pipeline's layout." << std::endl;
+            continue;
+        }
+
         switch (descriptorInfo.type) {
         case DescriptorInfo::Type::BUFFER: {
             D3D12_CPU_DESCRIPTOR_HANDLE destCpuHandle = {};
@@ -1168,8 +1210,9 @@ void GraphicsAPI_D3D12::UpdateDescriptors() {
             D3D12_GPU_DESCRIPTOR_HANDLE destGpuHandle = {};
             destGpuHandle.ptr = CBV_SRV_UAV_DescriptorHeap->GetGPUDescriptorHandleForHeapStart().ptr + Current_CBV_SRV_UAV_DescriptorOffset;
 
-            ID3D12Resource *d3d12Buffer = reinterpret_cast<ID3D12Resource *>(descriptorInfo.resource);
-            const BufferCreateInfo &bufferCI = bufferResources[d3d12Buffer].second;
+            const BufferResource &bufferResource = bufferResources[BufferHandle::FromPointer(descriptorInfo.resource)];
+            ID3D12Resource *d3d12Buffer = bufferResource.buffer;
+            const BufferCreateInfo &bufferCI = bufferResource.bufferCI;
 
             if (descriptorInfo.readWrite) {
                 D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc;
@@ -1223,8 +1266,6 @@ void GraphicsAPI_D3D12::UpdateDescriptors() {
             continue;
         }
         }
-
-        rootParameterIndex++;
     }
 
     CBV_SRV_UAV_DescriptorOffset = Current_CBV_SRV_UAV_DescriptorOffset;
@@ -1233,15 +1274,25 @@ void GraphicsAPI_D3D12::UpdateDescriptors() {
     descriptorInfos.clear();
 }
 
-void GraphicsAPI_D3D12::SetVertexBuffers(void **vertexBuffers, size_t count) {
+void GraphicsAPI_D3D12::SetPushConstants(DescriptorInfo::Stage stage, uint32_t offset, uint32_t size, const void *data) {
+    const PipelineCreateInfo &pipelineCI = pipelineResources[setPipeline].pipelineCI;
+    if (pipelineCI.pushConstantRanges.empty()) {
+        std::cout << "ERROR: D3D12: The current pipeline has no push constant ranges." << std::endl;
+        DEBUG_BREAK;
+        return;
+    }
+    cmdList->SetGraphicsRoot32BitConstants(static_cast<UINT>(pipelineCI.layout.size()), size / 4, data, offset / 4);
+}
+
+void GraphicsAPI_D3D12::SetVertexBuffers(BufferHandle *vertexBuffers, size_t count) {
     std::vector<D3D12_VERTEX_BUFFER_VIEW> vertexBufferViews;
     vertexBufferViews.reserve(count);
     for (size_t i = 0; i < count; i++) {
-        const PipelineCreateInfo &pipelineCI = pipelineResources[setPipeline].second;
+        const PipelineCreateInfo &pipelineCI = pipelineResources[setPipeline].pipelineCI;
         for (const VertexInputBinding &vertexBinding : pipelineCI.vertexInputState.bindings) {
             if (vertexBinding.bindingIndex == (uint32_t)i) {
                 D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
-                ID3D12Resource *d3d12VertexBuffer = reinterpret_cast<ID3D12Resource *>(vertexBuffers[i]);
+                ID3D12Resource *d3d12VertexBuffer = bufferResources[vertexBuffers[i]].buffer;
                 vertexBufferView.BufferLocation = d3d12VertexBuffer->GetGPUVirtualAddress();
                 vertexBufferView.SizeInBytes = d3d12VertexBuffer->GetDesc().Width;
                 vertexBufferView.StrideInBytes = vertexBinding.stride;
@@ -1252,9 +1303,10 @@ void GraphicsAPI_D3D12::SetVertexBuffers(void **vertexBuffers, size_t count) {
     cmdList->IASetVertexBuffers(0, static_cast<UINT>(vertexBufferViews.size()), vertexBufferViews.data());
 }
 
-void GraphicsAPI_D3D12::SetIndexBuffer(void *indexBuffer) {
-    ID3D12Resource *d3d12IndexBuffer = reinterpret_cast<ID3D12Resource *>(indexBuffer);
-    const BufferCreateInfo &bufferCI = bufferResources[d3d12IndexBuffer].second;
+void GraphicsAPI_D3D12::SetIndexBuffer(BufferHandle indexBuffer) {
+    const BufferResource &bufferResource = bufferResources[indexBuffer];
+    ID3D12Resource *d3d12IndexBuffer = bufferResource.buffer;
+    const BufferCreateInfo &bufferCI = bufferResource.bufferCI;
     D3D12_INDEX_BUFFER_VIEW indexBufferView;
     indexBufferView.BufferLocation = d3d12IndexBuffer->GetGPUVirtualAddress();
     indexBufferView.SizeInBytes = d3d12IndexBuffer->GetDesc().Width;
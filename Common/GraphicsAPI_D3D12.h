@@ -8,7 +8,7 @@
 #include <GraphicsAPI.h>
 
 #if defined(XR_USE_GRAPHICS_API_D3D12)
-class GraphicsAPI_D3D12 : public GraphicsAPI {
+class GraphicsAPI_D3D12 final : public GraphicsAPI {
 public:
     GraphicsAPI_D3D12();
     GraphicsAPI_D3D12(XrInstance m_xrInstance, XrSystemId systemId);
@@ -49,14 +49,14 @@ public:
     virtual void* CreateSampler(const SamplerCreateInfo& samplerCI) override;
     virtual void DestroySampler(void*& sampler) override;
 
-    virtual void* CreateBuffer(const BufferCreateInfo& bufferCI) override;
-    virtual void DestroyBuffer(void*& buffer) override;
+    virtual BufferHandle CreateBuffer(const BufferCreateInfo& bufferCI) override;
+    virtual void DestroyBuffer(BufferHandle& buffer) override;
 
     virtual void* CreateShader(const ShaderCreateInfo& shaderCI) override;
     virtual void DestroyShader(void*& shader) override;
 
-    virtual void* CreatePipeline(const PipelineCreateInfo& pipelineCI) override;
-    virtual void DestroyPipeline(void*& pipeline) override;
+    virtual PipelineHandle CreatePipeline(const PipelineCreateInfo& pipelineCI) override;
+    virtual void DestroyPipeline(PipelineHandle& pipeline) override;
 
     virtual void BeginRendering() override;
     virtual void EndRendering() override;
@@ -64,17 +64,18 @@ public:
     virtual void ClearColor(void* imageView, float r, float g, float b, float a) override;
     virtual void ClearDepth(void* imageView, float d) override;
 
-    virtual void SetBufferData(void* buffer, size_t offset, size_t size, void* data) override;
+    virtual void SetBufferData(BufferHandle buffer, size_t offset, size_t size, void* data) override;
 
-    virtual void SetRenderAttachments(void** colorViews, size_t colorViewCount, void* depthStencilView, uint32_t width, uint32_t height, void* pipeline) override;
+    virtual void SetRenderAttachments(void** colorViews, size_t colorViewCount, void* depthStencilView, uint32_t width, uint32_t height, PipelineHandle pipeline) override;
     virtual void SetViewports(Viewport* viewports, size_t count) override;
     virtual void SetScissors(Rect2D* scissors, size_t count) override;
 
-    virtual void SetPipeline(void* pipeline) override;
+    virtual void SetPipeline(PipelineHandle pipeline) override;
     virtual void SetDescriptor(const DescriptorInfo& descriptorInfo) override;
     virtual void UpdateDescriptors() override;
-    virtual void SetVertexBuffers(void** vertexBuffers, size_t count) override;
-    virtual void SetIndexBuffer(void* indexBuffer) override;
+    virtual void SetPushConstants(DescriptorInfo::Stage stage, uint32_t offset, uint32_t size, const void* data) override;
+    virtual void SetVertexBuffers(BufferHandle* vertexBuffers, size_t count) override;
+    virtual void SetIndexBuffer(BufferHandle indexBuffer) override;
     virtual void DrawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t firstInstance = 0) override;
     virtual void Draw(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0) override;
 
@@ -104,7 +105,13 @@ private:
     std::unordered_map<SIZE_T, std::pair<ID3D12DescriptorHeap*, ID3D12Resource*>> imageViewResources;
     std::unordered_map<SIZE_T, ID3D12DescriptorHeap*> samplerResources;
 
-    std::unordered_map<ID3D12Resource*, std::pair<ID3D12Heap*, BufferCreateInfo>> bufferResources;
+    // Buffers and pipelines are looked up on every draw, so they're kept in SlotMaps.
+    struct BufferResource {
+        ID3D12Resource* buffer = nullptr;
+        ID3D12Heap* heap = nullptr;
+        BufferCreateInfo bufferCI;
+    };
+    SlotMap<BufferResource, BufferTag> bufferResources;
 
     std::unordered_map<D3D12_SHADER_BYTECODE*, std::pair<std::vector<char>, ShaderCreateInfo>> shaders;
 
@@ -115,7 +122,17 @@ private:
     UINT SAMPLER_DescriptorOffset = 0;
     bool setDescriptorHeap = true;
 
-    std::unordered_map<ID3D12PipelineState*, std::pair<ID3D12RootSignature*, PipelineCreateInfo>> pipelineResources;
-    ID3D12PipelineState* setPipeline = nullptr;
+    struct PipelineResource {
+        ID3D12PipelineState* pipeline = nullptr;
+        ID3D12RootSignature* rootSignature = nullptr;
+        PipelineCreateInfo pipelineCI;
+    };
+    SlotMap<PipelineResource, PipelineTag> pipelineResources;
+    PipelineHandle setPipeline;
+};
+
+template <>
+struct GraphicsAPI_Backend<D3D12> {
+    typedef GraphicsAPI_D3D12 Type;
 };
 #endif
\ No newline at end of file
@@ -12,6 +12,14 @@
 PROC GetExtension(const char *functionName) { return wglGetProcAddress(functionName); }
 #elif defined(OS_APPLE)
 void (*GetExtension(const char *functionName))() { return NULL; }
+#elif (defined(OS_LINUX_XCB) || defined(OS_LINUX_XLIB) || defined(OS_LINUX_XCB_GLX)) && defined(XR_TUTORIAL_USE_OPENGL_EGL)
+void (*GetExtension(const char *functionName))() {
+    // A headless context is created through EGL, so its functions must be resolved through EGL too.
+    if (eglGetCurrentContext() != EGL_NO_CONTEXT) {
+        return eglGetProcAddress(functionName);
+    }
+    return glXGetProcAddress((const GLubyte *)functionName);
+}
 #elif defined(OS_LINUX_XCB) || defined(OS_LINUX_XLIB) || defined(OS_LINUX_XCB_GLX)
 void (*GetExtension(const char *functionName))() { return glXGetProcAddress((const GLubyte *)functionName); }
 #elif defined(OS_ANDROID) || defined(OS_LINUX_WAYLAND)
@@ -355,6 +363,378 @@ void GLDebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLs
         DEBUG_BREAK;
 }
 
+template <typename PFN>
+static void LoadFunction(PFN &function, const char *functionName, std::vector<std::string> *missingFunctionNames) {
+    function = (PFN)GetExtension(functionName);
+    if (!function && missingFunctionNames) {
+        missingFunctionNames->push_back(functionName);
+    }
+}
+
+void GraphicsAPI_OpenGL::LoadFunctions() {
+    // Resolve every entry point once, rather than on each call. Optional extension functions are allowed to be missing.
+    std::vector<std::string> missingFunctionNames;
+    LoadFunction(glGenSamplers, "glGenSamplers", &missingFunctionNames);
+    LoadFunction(glSamplerParameteri, "glSamplerParameteri", &missingFunctionNames);
+    LoadFunction(glSamplerParameterf, "glSamplerParameterf", &missingFunctionNames);
+    LoadFunction(glSamplerParameterfv, "glSamplerParameterfv", &missingFunctionNames);
+    LoadFunction(glDeleteSamplers, "glDeleteSamplers", &missingFunctionNames);
+    LoadFunction(glValidateProgram, "glValidateProgram", &missingFunctionNames);
+    LoadFunction(glDetachShader, "glDetachShader", &missingFunctionNames);
+    LoadFunction(glViewportIndexedf, "glViewportIndexedf", &missingFunctionNames);
+    LoadFunction(glDepthRangeIndexed, "glDepthRangeIndexed", &missingFunctionNames);
+    LoadFunction(glScissorIndexed, "glScissorIndexed", &missingFunctionNames);
+    LoadFunction(glMinSampleShading, "glMinSampleShading", &missingFunctionNames);
+    LoadFunction(glSampleMaski, "glSampleMaski", &missingFunctionNames);
+    LoadFunction(glDepthBoundsEXT, "glDepthBoundsEXT", nullptr);
+    LoadFunction(glStencilOpSeparate, "glStencilOpSeparate", &missingFunctionNames);
+    LoadFunction(glStencilFuncSeparate, "glStencilFuncSeparate", &missingFunctionNames);
+    LoadFunction(glStencilMaskSeparate, "glStencilMaskSeparate", &missingFunctionNames);
+    LoadFunction(glEnablei, "glEnablei", &missingFunctionNames);
+    LoadFunction(glDisablei, "glDisablei", &missingFunctionNames);
+    LoadFunction(glBlendEquationSeparatei, "glBlendEquationSeparatei", &missingFunctionNames);
+    LoadFunction(glBlendFuncSeparatei, "glBlendFuncSeparatei", &missingFunctionNames);
+    LoadFunction(glColorMaski, "glColorMaski", &missingFunctionNames);
+    LoadFunction(glBindBufferRange, "glBindBufferRange", &missingFunctionNames);
+    LoadFunction(glBindSampler, "glBindSampler", &missingFunctionNames);
+    LoadFunction(glDrawElementsInstancedBaseVertexBaseInstance, "glDrawElementsInstancedBaseVertexBaseInstance", &missingFunctionNames);
+    LoadFunction(glDrawArraysInstancedBaseInstance, "glDrawArraysInstancedBaseInstance", &missingFunctionNames);
+    LoadFunction(glGetStringi, "glGetStringi", &missingFunctionNames);
+    LoadFunction(glVertexAttribDivisor, "glVertexAttribDivisor", &missingFunctionNames);
+    LoadFunction(glBufferStorage, "glBufferStorage", nullptr);
+    LoadFunction(glProgramParameteri, "glProgramParameteri", nullptr);
+    LoadFunction(glGetProgramBinary, "glGetProgramBinary", nullptr);
+    LoadFunction(glProgramBinary, "glProgramBinary", nullptr);
+    LoadFunction(glMultiDrawElementsIndirect, "glMultiDrawElementsIndirect", nullptr);
+
+    for (const std::string &functionName : missingFunctionNames) {
+        std::cout << "ERROR: OPENGL: Failed to load function: " << functionName << std::endl;
+    }
+    if (!missingFunctionNames.empty()) {
+        DEBUG_BREAK;
+    }
+
+    glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+
+    // Direct State Access is optional. Without it, objects are bound to be modified.
+    std::vector<std::string> missingDirectStateAccessFunctionNames;
+    LoadFunction(glCreateBuffers, "glCreateBuffers", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glNamedBufferData, "glNamedBufferData", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glNamedBufferSubData, "glNamedBufferSubData", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glNamedBufferStorage, "glNamedBufferStorage", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glMapNamedBufferRange, "glMapNamedBufferRange", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glUnmapNamedBuffer, "glUnmapNamedBuffer", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glCreateFramebuffers, "glCreateFramebuffers", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glNamedFramebufferTexture, "glNamedFramebufferTexture", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glCheckNamedFramebufferStatus, "glCheckNamedFramebufferStatus", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glClearNamedFramebufferfv, "glClearNamedFramebufferfv", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glCreateVertexArrays, "glCreateVertexArrays", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glEnableVertexArrayAttrib, "glEnableVertexArrayAttrib", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glVertexArrayAttribFormat, "glVertexArrayAttribFormat", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glVertexArrayAttribBinding, "glVertexArrayAttribBinding", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glVertexArrayVertexBuffer, "glVertexArrayVertexBuffer", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glVertexArrayElementBuffer, "glVertexArrayElementBuffer", &missingDirectStateAccessFunctionNames);
+    LoadFunction(glVertexArrayBindingDivisor, "glVertexArrayBindingDivisor", &missingDirectStateAccessFunctionNames);
+    directStateAccess = IsVersionSupported(4, 5) || IsExtensionSupported("GL_ARB_direct_state_access");
+    directStateAccess &= missingDirectStateAccessFunctionNames.empty();
+
+    multiDrawIndirect = glMultiDrawElementsIndirect && (IsVersionSupported(4, 3) || IsExtensionSupported("GL_ARB_multi_draw_indirect"));
+}
+
+bool GraphicsAPI_OpenGL::IsVersionSupported(GLint major, GLint minor) {
+    return majorVersion > major || (majorVersion == major && minorVersion >= minor);
+}
+
+bool GraphicsAPI_OpenGL::IsExtensionSupported(const char *extensionName) {
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; i++) {
+        if (strcmp((const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i), extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void GraphicsAPI_OpenGL::CreateStreamingBuffer() {
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    uniformBufferOffsetAlignment = std::max(size_t(alignment), uniformBufferOffsetAlignment);
+    streamingOffsetAlignment = uniformBufferOffsetAlignment;
+
+    bufferStorage = glBufferStorage && (IsVersionSupported(4, 4) || IsExtensionSupported("GL_ARB_buffer_storage"));
+
+    const GLsizeiptr size = (GLsizeiptr)(streamingRegionSize * streamingRegionCount);
+    if (directStateAccess && bufferStorage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glCreateBuffers(1, &streamingBuffer);
+        glNamedBufferStorage(streamingBuffer, size, nullptr, flags);
+        streamingBufferMappedData = (uint8_t *)glMapNamedBufferRange(streamingBuffer, 0, size, flags);
+        if (!streamingBufferMappedData) {
+            std::cout << "ERROR: OPENGL: Failed to map streaming buffer." << std::endl;
+            DEBUG_BREAK;
+        }
+        streamingBufferHandle = buffers.Insert({streamingBuffer, {BufferCreateInfo::Type::UNIFORM, 0, (size_t)size, nullptr, BufferCreateInfo::Usage::STREAM}});
+        streamingFences.resize(streamingRegionCount, nullptr);
+        streamingRegionIndex = 0;
+        streamingOffset = 0;
+        return;
+    }
+
+    glGenBuffers(1, &streamingBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, streamingBuffer);
+    if (bufferStorage) {
+        // Persistently mapped and coherent, so writes are visible to the GPU without flushing or unmapping. Each frame's region is protected by a fence instead.
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+        streamingBufferMappedData = (uint8_t *)glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags);
+        if (!streamingBufferMappedData) {
+            std::cout << "ERROR: OPENGL: Failed to map streaming buffer." << std::endl;
+            DEBUG_BREAK;
+        }
+    } else {
+        // Without buffer storage, the buffer is orphaned each frame instead.
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    streamingBufferHandle = buffers.Insert({streamingBuffer, {BufferCreateInfo::Type::UNIFORM, 0, (size_t)size, nullptr, BufferCreateInfo::Usage::STREAM}});
+    streamingFences.resize(streamingRegionCount, nullptr);
+    streamingRegionIndex = 0;
+    streamingOffset = 0;
+}
+
+// Header of the program binary cache file. It's followed by the driver string and then the entries.
+// Files written by another renderer or driver version are ignored, rather than handed to the driver.
+struct ProgramBinaryCacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t driverStringSize;
+};
+// Header of each program binary in the cache file. It's followed by dataSize bytes of binary.
+struct ProgramBinaryCacheEntryHeader {
+    uint64_t hash;
+    uint32_t format;
+    uint32_t dataSize;
+};
+static constexpr uint32_t programBinaryCacheFileMagic = 0x4B42504F;  // "OPBK"
+static constexpr uint32_t programBinaryCacheFileVersion = 1;
+
+static uint64_t HashData(uint64_t hash, const void *data, size_t size) {
+    // FNV-1a, so the hash is the same from one launch to the next.
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+void GraphicsAPI_OpenGL::LoadProgramBinaryCache() {
+    GLint binaryFormatCount = 0;
+    if (glProgramParameteri && glGetProgramBinary && glProgramBinary && (IsVersionSupported(4, 1) || IsExtensionSupported("GL_ARB_get_program_binary"))) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount);
+    }
+    programBinaryCacheEnabled = binaryFormatCount > 0;
+    if (!programBinaryCacheEnabled) {
+        return;
+    }
+
+    // The renderer and driver version identify whether the binaries can be loaded.
+    driverString = std::string((const char *)glGetString(GL_VENDOR)) + " " + (const char *)glGetString(GL_RENDERER) + " " + (const char *)glGetString(GL_VERSION);
+
+    std::vector<char> fileData = ReadBinaryFile(programBinaryCacheFilepath);
+    if (fileData.size() < sizeof(ProgramBinaryCacheFileHeader)) {
+        return;
+    }
+    ProgramBinaryCacheFileHeader header;
+    memcpy(&header, fileData.data(), sizeof(ProgramBinaryCacheFileHeader));
+    size_t offset = sizeof(ProgramBinaryCacheFileHeader);
+    if (header.magic != programBinaryCacheFileMagic || header.version != programBinaryCacheFileVersion
+        || header.driverStringSize != driverString.size() || fileData.size() < offset + header.driverStringSize
+        || memcmp(fileData.data() + offset, driverString.data(), driverString.size()) != 0) {
+        std::cout << "WARNING: OPENGL: Ignoring program binary cache " << programBinaryCacheFilepath << ". It was written by a different renderer or driver." << std::endl;
+        return;
+    }
+    offset += header.driverStringSize;
+
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        ProgramBinaryCacheEntryHeader entryHeader;
+        if (fileData.size() < offset + sizeof(ProgramBinaryCacheEntryHeader)) {
+            break;
+        }
+        memcpy(&entryHeader, fileData.data() + offset, sizeof(ProgramBinaryCacheEntryHeader));
+        offset += sizeof(ProgramBinaryCacheEntryHeader);
+        if (fileData.size() < offset + entryHeader.dataSize) {
+            break;
+        }
+        ProgramBinary &programBinary = programBinaries[entryHeader.hash];
+        programBinary.format = (GLenum)entryHeader.format;
+        programBinary.data.assign(fileData.data() + offset, fileData.data() + offset + entryHeader.dataSize);
+        offset += entryHeader.dataSize;
+    }
+}
+
+void GraphicsAPI_OpenGL::SaveProgramBinaryCache() {
+    if (!programBinaryCacheEnabled || !programBinaryCacheModified) {
+        return;
+    }
+
+    ProgramBinaryCacheFileHeader header;
+    header.magic = programBinaryCacheFileMagic;
+    header.version = programBinaryCacheFileVersion;
+    header.entryCount = (uint32_t)programBinaries.size();
+    header.driverStringSize = (uint32_t)driverString.size();
+
+    std::ofstream stream(programBinaryCacheFilepath, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+    if (!stream.is_open()) {
+        std::cout << "WARNING: OPENGL: Could not write program binary cache " << programBinaryCacheFilepath << "." << std::endl;
+        return;
+    }
+    stream.write((const char *)&header, sizeof(ProgramBinaryCacheFileHeader));
+    stream.write(driverString.data(), static_cast<std::streamsize>(driverString.size()));
+    for (const auto &programBinary : programBinaries) {
+        ProgramBinaryCacheEntryHeader entryHeader;
+        entryHeader.hash = programBinary.first;
+        entryHeader.format = (uint32_t)programBinary.second.format;
+        entryHeader.dataSize = (uint32_t)programBinary.second.data.size();
+        stream.write((const char *)&entryHeader, sizeof(ProgramBinaryCacheEntryHeader));
+        stream.write(programBinary.second.data.data(), static_cast<std::streamsize>(programBinary.second.data.size()));
+    }
+    stream.close();
+    programBinaryCacheModified = false;
+}
+
+void GraphicsAPI_OpenGL::DestroyStreamingBuffer() {
+    for (GLsync &fence : streamingFences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (streamingBufferMappedData) {
+        if (directStateAccess) {
+            glUnmapNamedBuffer(streamingBuffer);
+        } else {
+            glBindBuffer(GL_UNIFORM_BUFFER, streamingBuffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        streamingBufferMappedData = nullptr;
+    }
+    buffers.Erase(streamingBufferHandle);
+    streamingBufferHandle = BufferHandle();
+    glDeleteBuffers(1, &streamingBuffer);
+    streamingBuffer = 0;
+    if (pushConstantsBuffer) {
+        glDeleteBuffers(1, &pushConstantsBuffer);
+        pushConstantsBuffer = 0;
+    }
+}
+
+uint64_t GraphicsAPI_OpenGL::FloatBits(float value) {
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+void GraphicsAPI_OpenGL::SetCapability(Capability capability, bool enable) {
+    static const GLenum glCapabilities[(size_t)Capability::COUNT] = {
+        GL_PRIMITIVE_RESTART, GL_DEPTH_CLAMP, GL_RASTERIZER_DISCARD, GL_CULL_FACE,
+        GL_POLYGON_OFFSET_FILL, GL_POLYGON_OFFSET_LINE, GL_POLYGON_OFFSET_POINT,
+        GL_MULTISAMPLE, GL_SAMPLE_SHADING, GL_SAMPLE_MASK, GL_SAMPLE_ALPHA_TO_COVERAGE, GL_SAMPLE_ALPHA_TO_ONE,
+        GL_DEPTH_TEST, GL_DEPTH_BOUNDS_TEST_EXT, GL_STENCIL_TEST, GL_COLOR_LOGIC_OP};
+
+    uint8_t &applied = appliedCapabilities[(size_t)capability];
+    if (applied == 1 + (uint8_t)enable) {
+        skippedStateChangeCount++;
+        return;
+    }
+    applied = 1 + (uint8_t)enable;
+    if (enable) {
+        glEnable(glCapabilities[(size_t)capability]);
+    } else {
+        glDisable(glCapabilities[(size_t)capability]);
+    }
+}
+
+void GraphicsAPI_OpenGL::SetCapabilityIndexed(GLenum capability, GLuint index, bool enable) {
+    if (!StateChanged(State::CAPABILITY_INDEXED, index, capability, enable)) {
+        return;
+    }
+    if (enable) {
+        glEnablei(capability, index);
+    } else {
+        glDisablei(capability, index);
+    }
+}
+
+bool GraphicsAPI_OpenGL::StateChanged(State state, GLuint index, uint64_t value0, uint64_t value1, uint64_t value2, uint64_t value3) {
+    // State beyond the shadowed indices is always applied.
+    if (index >= maxShadowedStateIndex) {
+        return true;
+    }
+    // Indexed capabilities store the capability in value0, so a different capability at the same index is never skipped.
+    AppliedState &applied = appliedStates[(size_t)state][index];
+    const std::array<uint64_t, 4> values = {value0, value1, value2, value3};
+    if (applied.valid && applied.values == values) {
+        skippedStateChangeCount++;
+        return false;
+    }
+    applied.values = values;
+    applied.valid = true;
+    return true;
+}
+
+void GraphicsAPI_OpenGL::ResetStateTracking() {
+    memset(appliedCapabilities, 0, sizeof(appliedCapabilities));
+    memset(appliedStates, 0, sizeof(appliedStates));
+}
+
+bool GraphicsAPI_OpenGL::IsHeadlessRequested() {
+    // XR_TUTORIAL_OPENGL_HEADLESS=1 forces the EGL path; without a display server it is chosen automatically.
+    const std::string headlessEnv = GetEnv("XR_TUTORIAL_OPENGL_HEADLESS");
+#if defined(XR_TUTORIAL_USE_OPENGL_EGL)
+    if (!headlessEnv.empty()) {
+        return headlessEnv != "0";
+    }
+    return GetEnv("DISPLAY").empty() && GetEnv("WAYLAND_DISPLAY").empty();
+#else
+    if (!headlessEnv.empty() && headlessEnv != "0") {
+        std::cout << "WARNING: OPENGL: XR_TUTORIAL_OPENGL_HEADLESS is set, but this build has no EGL support. Configure with XR_TUTORIAL_OPENGL_EGL=ON." << std::endl;
+    }
+    return false;
+#endif
+}
+
+bool GraphicsAPI_OpenGL::CreateHeadlessContext() {
+#if defined(XR_TUTORIAL_USE_OPENGL_EGL)
+    // Match the version and profile that gfxwrapper requests for its windowed context.
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE};
+    if (!eglHeadlessContext.Create(EGL_OPENGL_API, EGL_OPENGL_BIT, contextAttribs)) {
+        return false;
+    }
+
+    // ksGpuWindow_Create normally loads gfxwrapper's function pointers; do the same for the EGL context.
+    GlInitExtensions();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void GraphicsAPI_OpenGL::DestroyHeadlessContext() {
+#if defined(XR_TUTORIAL_USE_OPENGL_EGL)
+    eglHeadlessContext.Destroy();
+#endif
+}
+
 GraphicsAPI_OpenGL::GraphicsAPI_OpenGL() {
     // https://github.com/KhronosGroup/OpenXR-SDK-Source/blob/f122f9f1fc729e2dc82e12c3ce73efa875182854/src/tests/hello_xr/graphicsplugin_opengl.cpp#L103-L121
     // Initialize the gl extensions. Note we have to open a window.
@@ -363,7 +743,12 @@ GraphicsAPI_OpenGL::GraphicsAPI_OpenGL() {
     ksGpuSurfaceColorFormat colorFormat{KS_GPU_SURFACE_COLOR_FORMAT_B8G8R8A8};
     ksGpuSurfaceDepthFormat depthFormat{KS_GPU_SURFACE_DEPTH_FORMAT_D24};
     ksGpuSampleCount sampleCount{KS_GPU_SAMPLE_COUNT_1};
-    if (!ksGpuWindow_Create(&window, &driverInstance, &queueInfo, 0, colorFormat, depthFormat, sampleCount, 640, 480, false)) {
+    headless = IsHeadlessRequested();
+    if (headless) {
+        if (!CreateHeadlessContext()) {
+            std::cerr << "ERROR: OPENGL: Failed to create headless Context." << std::endl;
+        }
+    } else if (!ksGpuWindow_Create(&window, &driverInstance, &queueInfo, 0, colorFormat, depthFormat, sampleCount, 640, 480, false)) {
         std::cerr << "ERROR: OPENGL: Failed to create Context." << std::endl;
     }
 
@@ -377,6 +762,10 @@ GraphicsAPI_OpenGL::GraphicsAPI_OpenGL() {
     glDebugMessageCallback(GLDebugCallback, nullptr);
     glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
     glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+
+    LoadFunctions();
+    CreateStreamingBuffer();
+    LoadProgramBinaryCache();
 }
 
 // XR_DOCS_TAG_BEGIN_GraphicsAPI_OpenGL
@@ -392,7 +781,12 @@ GraphicsAPI_OpenGL::GraphicsAPI_OpenGL(XrInstance m_xrInstance, XrSystemId syste
     ksGpuSurfaceColorFormat colorFormat{KS_GPU_SURFACE_COLOR_FORMAT_B8G8R8A8};
     ksGpuSurfaceDepthFormat depthFormat{KS_GPU_SURFACE_DEPTH_FORMAT_D24};
     ksGpuSampleCount sampleCount{KS_GPU_SAMPLE_COUNT_1};
-    if (!ksGpuWindow_Create(&window, &driverInstance, &queueInfo, 0, colorFormat, depthFormat, sampleCount, 640, 480, false)) {
+    headless = IsHeadlessRequested();
+    if (headless) {
+        if (!CreateHeadlessContext()) {
+            std::cerr << "ERROR: OPENGL: Failed to create headless Context." << std::endl;
+        }
+    } else if (!ksGpuWindow_Create(&window, &driverInstance, &queueInfo, 0, colorFormat, depthFormat, sampleCount, 640, 480, false)) {
         std::cerr << "ERROR: OPENGL: Failed to create Context." << std::endl;
     }
 
@@ -413,10 +807,32 @@ GraphicsAPI_OpenGL::GraphicsAPI_OpenGL(XrInstance m_xrInstance, XrSystemId syste
     glDebugMessageCallback(GLDebugCallback, nullptr);
     glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
     glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+
+    LoadFunctions();
+    CreateStreamingBuffer();
+    LoadProgramBinaryCache();
 }
 
 GraphicsAPI_OpenGL::~GraphicsAPI_OpenGL() {
-    ksGpuWindow_Destroy(&window);
+    SaveProgramBinaryCache();
+    DestroyStreamingBuffer();
+
+    for (const auto &framebuffer : framebufferCache) {
+        glDeleteFramebuffers(1, &framebuffer.second);
+    }
+    framebufferCache.clear();
+
+    for (const auto &vertexArray : vertexArrayCache) {
+        glDeleteVertexArrays(1, &vertexArray.second);
+    }
+    vertexArrayCache.clear();
+    glDeleteVertexArrays(1, &emptyVertexArray);
+
+    if (headless) {
+        DestroyHeadlessContext();
+    } else {
+        ksGpuWindow_Destroy(&window);
+    }
 }
 // XR_DOCS_TAG_END_GraphicsAPI_OpenGL
 
@@ -425,6 +841,9 @@ void GraphicsAPI_OpenGL::DestroyDesktopSwapchain(void *&swapchain) {}
 void *GraphicsAPI_OpenGL::GetDesktopSwapchainImage(void *swapchain, uint32_t index) { return nullptr; }
 void GraphicsAPI_OpenGL::AcquireDesktopSwapchanImage(void *swapchain, uint32_t &index) {}
 void GraphicsAPI_OpenGL::PresentDesktopSwapchainImage(void *swapchain, uint32_t index) {
+    if (headless) {
+        return;
+    }
 #if defined(XR_USE_PLATFORM_WIN32)
     SwapBuffers(window.hDC);
 #elif defined(XR_USE_PLATFORM_XLIB) || defined(XR_USE_PLATFORM_XCB)
@@ -435,6 +854,17 @@ void GraphicsAPI_OpenGL::PresentDesktopSwapchainImage(void *swapchain, uint32_t
 // XR_DOCS_TAG_BEGIN_GraphicsAPI_OpenGL_GetGraphicsBinding
 void *GraphicsAPI_OpenGL::GetGraphicsBinding() {
     // https://github.com/KhronosGroup/OpenXR-SDK-Source/blob/f122f9f1fc729e2dc82e12c3ce73efa875182854/src/tests/hello_xr/graphicsplugin_opengl.cpp#L123-L144
+#if defined(XR_TUTORIAL_USE_OPENGL_EGL)
+    // A headless context has no window system objects, so it is handed to the runtime via XR_MNDX_egl_enable.
+    if (headless) {
+        eglGraphicsBinding = {XR_TYPE_GRAPHICS_BINDING_EGL_MNDX};
+        eglGraphicsBinding.getProcAddress = reinterpret_cast<PFN_xrEglGetProcAddressMNDX>(eglGetProcAddress);
+        eglGraphicsBinding.display = eglHeadlessContext.display;
+        eglGraphicsBinding.config = eglHeadlessContext.config;
+        eglGraphicsBinding.context = eglHeadlessContext.context;
+        return &eglGraphicsBinding;
+    }
+#endif
 #if defined(XR_USE_PLATFORM_WIN32)
     graphicsBinding = {XR_TYPE_GRAPHICS_BINDING_OPENGL_WIN32_KHR};
     graphicsBinding.hDC = window.context.hDC;
@@ -505,13 +935,16 @@ void *GraphicsAPI_OpenGL::CreateImage(const ImageCreateInfo &imageCI) {
 
     glBindTexture(target, 0);
 
-    images[texture] = imageCI;
+    if (texture >= imageTargets.size()) {
+        imageTargets.resize(texture + 1, 0);
+    }
+    imageTargets[texture] = target;
     return (void *)(uint64_t)texture;
 }
 
 void GraphicsAPI_OpenGL::DestroyImage(void *&image) {
     GLuint texture = (GLuint)(uint64_t)image;
-    images.erase(texture);
+    imageTargets[texture] = 0;
     glDeleteTextures(1, &texture);
     image = nullptr;
 }
@@ -545,6 +978,19 @@ void *GraphicsAPI_OpenGL::CreateImageView(const ImageViewCreateInfo &imageViewCI
 
 void GraphicsAPI_OpenGL::DestroyImageView(void *&imageView) {
     GLuint framebuffer = (GLuint)(uint64_t)imageView;
+    // Remove any cached framebuffers that use this ImageView, as its handle may be reused.
+    for (auto it = framebufferCache.begin(); it != framebufferCache.end();) {
+        if (std::find(it->first.begin(), it->first.end(), framebuffer) != it->first.end()) {
+            if (setFramebuffer == it->second) {
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                setFramebuffer = 0;
+            }
+            glDeleteFramebuffers(1, &it->second);
+            it = framebufferCache.erase(it);
+        } else {
+            it++;
+        }
+    }
     imageViews.erase(framebuffer);
     glDeleteFramebuffers(1, &framebuffer);
     imageView = nullptr;
@@ -552,13 +998,8 @@ void GraphicsAPI_OpenGL::DestroyImageView(void *&imageView) {
 
 void *GraphicsAPI_OpenGL::CreateSampler(const SamplerCreateInfo &samplerCI) {
     GLuint sampler = 0;
-    PFNGLGENSAMPLERSPROC glGenSamplers = (PFNGLGENSAMPLERSPROC)GetExtension("glGenSamplers");  // 3.2+
     glGenSamplers(1, &sampler);
 
-    PFNGLSAMPLERPARAMETERIPROC glSamplerParameteri = (PFNGLSAMPLERPARAMETERIPROC)GetExtension("glSamplerParameteri");      // 3.2+
-    PFNGLSAMPLERPARAMETERFPROC glSamplerParameterf = (PFNGLSAMPLERPARAMETERFPROC)GetExtension("glSamplerParameterf");      // 3.2+
-    PFNGLSAMPLERPARAMETERFVPROC glSamplerParameterfv = (PFNGLSAMPLERPARAMETERFVPROC)GetExtension("glSamplerParameterfv");  // 3.2+
-
     // Filter
     glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, ToGLFilter(samplerCI.magFilter));
     glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, ToGLFilterMipmap(samplerCI.minFilter, samplerCI.mipmapMode));
@@ -588,14 +1029,12 @@ void *GraphicsAPI_OpenGL::CreateSampler(const SamplerCreateInfo &samplerCI) {
 
 void GraphicsAPI_OpenGL::DestroySampler(void *&sampler) {
     GLuint glsampler = (GLuint)(uint64_t)sampler;
-    PFNGLDELETESAMPLERSPROC glDeleteSamplers = (PFNGLDELETESAMPLERSPROC)GetExtension("glDeleteSamplers");  // 3.2+
     glDeleteSamplers(1, &glsampler);
     sampler = nullptr;
 }
 
-void *GraphicsAPI_OpenGL::CreateBuffer(const BufferCreateInfo &bufferCI) {
+GraphicsAPI::BufferHandle GraphicsAPI_OpenGL::CreateBuffer(const BufferCreateInfo &bufferCI) {
     GLuint buffer = 0;
-    glGenBuffers(1, &buffer);
 
     GLenum target = 0;
     if (bufferCI.type == BufferCreateInfo::Type::VERTEX) {
@@ -609,19 +1048,80 @@ void *GraphicsAPI_OpenGL::CreateBuffer(const BufferCreateInfo &bufferCI) {
         std::cout << "ERROR: OPENGL: Unknown Buffer Type." << std::endl;
     }
 
-    glBindBuffer(target, buffer);
-    glBufferData(target, (GLsizeiptr)bufferCI.size, bufferCI.data, GL_STATIC_DRAW);
-    glBindBuffer(target, 0);
+    if (bufferStorage && bufferCI.usage != BufferCreateInfo::Usage::STATIC) {
+        // Persistently mapped and coherent, with one region per streaming region. Reading is allowed, so that a partial write can
+        // carry the rest of the contents over from the previous region.
+        const size_t regionSize = AlignSizeForUniformBuffer(bufferCI.size);
+        const GLsizeiptr size = (GLsizeiptr)(regionSize * streamingRegionCount);
+        const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        uint8_t *mappedData = nullptr;
+        if (directStateAccess) {
+            glCreateBuffers(1, &buffer);
+            glNamedBufferStorage(buffer, size, nullptr, flags);
+            mappedData = (uint8_t *)glMapNamedBufferRange(buffer, 0, size, flags);
+        } else {
+            glGenBuffers(1, &buffer);
+            glBindBuffer(target, buffer);
+            glBufferStorage(target, size, nullptr, flags);
+            mappedData = (uint8_t *)glMapBufferRange(target, 0, size, flags);
+            glBindBuffer(target, 0);
+        }
+        if (!mappedData) {
+            std::cout << "ERROR: OPENGL: Failed to map Buffer." << std::endl;
+            DEBUG_BREAK;
+        }
+
+        BufferResource bufferResource;
+        bufferResource.buffer = buffer;
+        bufferResource.bufferCI = bufferCI;
+        bufferResource.mappedData = mappedData;
+        bufferResource.regionSize = regionSize;
+        BufferHandle handle = buffers.Insert(bufferResource);
+        if (mappedData && bufferCI.data) {
+            WriteMappedBufferData(handle, 0, bufferCI.size, bufferCI.data);
+        }
+        return handle;
+    }
+
+    GLenum usage = GL_DYNAMIC_DRAW;
+    if (bufferCI.usage == BufferCreateInfo::Usage::STATIC) {
+        usage = GL_STATIC_DRAW;
+    } else if (bufferCI.usage == BufferCreateInfo::Usage::STREAM) {
+        usage = GL_STREAM_DRAW;
+    }
+
+    if (directStateAccess) {
+        glCreateBuffers(1, &buffer);
+        glNamedBufferData(buffer, (GLsizeiptr)bufferCI.size, bufferCI.data, usage);
+    } else {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(target, buffer);
+        glBufferData(target, (GLsizeiptr)bufferCI.size, bufferCI.data, usage);
+        glBindBuffer(target, 0);
+    }
 
-    buffers[buffer] = bufferCI;
-    return (void *)(uint64_t)buffer;
+    return buffers.Insert({buffer, bufferCI});
 }
 
-void GraphicsAPI_OpenGL::DestroyBuffer(void *&buffer) {
-    GLuint glBuffer = (GLuint)(uint64_t)buffer;
-    buffers.erase(glBuffer);
+void GraphicsAPI_OpenGL::DestroyBuffer(BufferHandle &buffer) {
+    GLuint glBuffer = buffers[buffer].buffer;
+    // Remove any cached vertex arrays that use this buffer, as its handle may be reused.
+    for (auto it = vertexArrayCache.begin(); it != vertexArrayCache.end();) {
+        const std::vector<GLuint> &vertexBuffers = it->first.second;
+        if (std::find(vertexBuffers.begin(), vertexBuffers.end(), glBuffer) != vertexBuffers.end()) {
+            if (vertexArray == it->second) {
+                glBindVertexArray(emptyVertexArray);
+                vertexArray = emptyVertexArray;
+            }
+            glDeleteVertexArrays(1, &it->second);
+            it = vertexArrayCache.erase(it);
+        } else {
+            it++;
+        }
+    }
+    buffers.Erase(buffer);
     glDeleteBuffers(1, &glBuffer);
-    buffer = nullptr;
+    buffer = BufferHandle();
 }
 
 void *GraphicsAPI_OpenGL::CreateShader(const ShaderCreateInfo &shaderCI) {
@@ -656,7 +1156,24 @@ void *GraphicsAPI_OpenGL::CreateShader(const ShaderCreateInfo &shaderCI) {
     }
     GLuint shader = glCreateShader(type);
 
-    glShaderSource(shader, 1, &shaderCI.sourceData, nullptr);
+    const GLint sourceSize = (GLint)shaderCI.sourceSize;
+    glShaderSource(shader, 1, &shaderCI.sourceData, &sourceSize);
+
+    // Compilation is deferred to CreatePipeline(), which doesn't need it when the linked program is in the program binary cache.
+    ShaderSource &shaderSource = shaderSources[shader];
+    shaderSource.type = type;
+    shaderSource.source.assign(shaderCI.sourceData, shaderCI.sourceSize);
+    shaderSource.compiled = false;
+
+    return (void *)(uint64_t)shader;
+}
+
+bool GraphicsAPI_OpenGL::CompileShader(GLuint shader) {
+    ShaderSource &shaderSource = shaderSources[shader];
+    if (shaderSource.compiled) {
+        return true;
+    }
+
     glCompileShader(shader);
 
     GLint isCompiled = 0;
@@ -669,29 +1186,52 @@ void *GraphicsAPI_OpenGL::CreateShader(const ShaderCreateInfo &shaderCI) {
         glGetShaderInfoLog(shader, maxLength, &maxLength, &infoLog[0]);
         std::cout << infoLog.data() << std::endl;
         DEBUG_BREAK;
-
-        glDeleteShader(shader);
-        shader = 0;
+        return false;
     }
-
-    return (void *)(uint64_t)shader;
+    shaderSource.compiled = true;
+    return true;
 }
 
 void GraphicsAPI_OpenGL::DestroyShader(void *&shader) {
     GLuint glShader = (GLuint)(uint64_t)shader;
+    shaderSources.erase(glShader);
     glDeleteShader(glShader);
     shader = nullptr;
 }
 
-void *GraphicsAPI_OpenGL::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
+GraphicsAPI::PipelineHandle GraphicsAPI_OpenGL::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
     GLuint program = glCreateProgram();
 
-    for (const void *const &shader : pipelineCI.shaders)
+    // Programs are cached by the hash of their shaders' types and sources.
+    uint64_t programHash = 0xCBF29CE484222325ull;
+    for (const void *const &shader : pipelineCI.shaders) {
+        const ShaderSource &shaderSource = shaderSources[(GLuint)(uint64_t)shader];
+        programHash = HashData(programHash, &shaderSource.type, sizeof(shaderSource.type));
+        programHash = HashData(programHash, shaderSource.source.data(), shaderSource.source.size());
+    }
+
+    if (programBinaryCacheEnabled) {
+        auto it = programBinaries.find(programHash);
+        if (it != programBinaries.end()) {
+            glProgramBinary(program, it->second.format, it->second.data.data(), (GLsizei)it->second.data.size());
+            GLint isLinked = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+            if (isLinked == GL_TRUE) {
+                return pipelines.Insert({program, pipelineCI});
+            }
+            // The driver rejected the binary, so compile from source and replace it.
+            programBinaries.erase(it);
+        }
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    for (const void *const &shader : pipelineCI.shaders) {
+        CompileShader((GLuint)(uint64_t)shader);
         glAttachShader(program, (GLuint)(uint64_t)shader);
+    }
 
     glLinkProgram(program);
 
-    PFNGLVALIDATEPROGRAMPROC glValidateProgram = (PFNGLVALIDATEPROGRAMPROC)GetExtension("glValidateProgram");  // 2.0+
     glValidateProgram(program);
 
     GLint isLinked = 0;
@@ -704,45 +1244,133 @@ void *GraphicsAPI_OpenGL::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
         glGetProgramInfoLog(program, maxLength, &maxLength, &infoLog[0]);
 
         glDeleteProgram(program);
+    } else if (programBinaryCacheEnabled) {
+        GLint binaryLength = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+        if (binaryLength > 0) {
+            ProgramBinary &programBinary = programBinaries[programHash];
+            programBinary.data.resize((size_t)binaryLength);
+            glGetProgramBinary(program, binaryLength, &binaryLength, &programBinary.format, programBinary.data.data());
+            programBinary.data.resize((size_t)binaryLength);
+            programBinaryCacheModified = true;
+        }
     }
 
-    PFNGLDETACHSHADERPROC glDetachShader = (PFNGLDETACHSHADERPROC)GetExtension("glDetachShader");  // 2.0+
     for (const void *const &shader : pipelineCI.shaders)
         glDetachShader(program, (GLuint)(uint64_t)shader);
 
-    pipelines[program] = pipelineCI;
-
-    return (void *)(uint64_t)program;
+    return pipelines.Insert({program, pipelineCI});
 }
 
-void GraphicsAPI_OpenGL::DestroyPipeline(void *&pipeline) {
-    GLint program = (GLuint)(uint64_t)pipeline;
-    pipelines.erase(program);
+void GraphicsAPI_OpenGL::DestroyPipeline(PipelineHandle &pipeline) {
+    GLuint program = pipelines[pipeline].program;
+    pipelines.Erase(pipeline);
     glDeleteProgram(program);
-    pipeline = nullptr;
+    // The program name may be reused, so don't let the shadowed state skip the next glUseProgram().
+    ResetStateTracking();
+    pipeline = PipelineHandle();
+}
+
+void GraphicsAPI_OpenGL::BeginFrame() {
+    BeginStreamingRegion();
+    inFrame = true;
+}
+
+void GraphicsAPI_OpenGL::EndFrame() {
+    EndStreamingRegion();
+    inFrame = false;
+}
+
+void GraphicsAPI_OpenGL::BeginStreamingRegion() {
+    // Move on to the next region of the streaming buffer, waiting for the GPU to finish the frame that last used it.
+    streamingRegionIndex = (streamingRegionIndex + 1) % streamingRegionCount;
+    streamingOffset = 0;
+    streamingFrameIndex++;
+    // The bound push constants may point into the region that is about to be reused, so they're streamed again before the next draw.
+    pushConstantsDirty = true;
+
+    GLsync &fence = streamingFences[streamingRegionIndex];
+    if (fence) {
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+        if (result == GL_WAIT_FAILED) {
+            std::cout << "ERROR: OPENGL: Failed to wait for streaming buffer fence." << std::endl;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    if (!streamingBufferMappedData) {
+        // Orphan the buffer, so the driver can hand out new storage rather than synchronizing with the previous frames.
+        const GLsizeiptr size = (GLsizeiptr)(streamingRegionSize * streamingRegionCount);
+        if (directStateAccess) {
+            glNamedBufferData(streamingBuffer, size, nullptr, GL_STREAM_DRAW);
+        } else {
+            glBindBuffer(GL_UNIFORM_BUFFER, streamingBuffer);
+            glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+    }
+
+    // The uniform buffers that are still bound are used by this frame too.
+    for (BufferHandle buffer : setUniformBuffers) {
+        if (buffers.IsValid(buffer)) {
+            UseBuffer(buffer);
+        }
+    }
+}
+
+void GraphicsAPI_OpenGL::EndStreamingRegion() {
+    // The fence protects both the streaming buffer's region and the regions of the persistently mapped buffers used in this frame.
+    if (bufferStorage) {
+        streamingFences[streamingRegionIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
 }
 
 void GraphicsAPI_OpenGL::BeginRendering() {
-    glGenVertexArrays(1, &vertexArray);
-    glBindVertexArray(vertexArray);
+    // Outside of BeginFrame()/EndFrame(), every BeginRendering()/EndRendering() pair streams into its own region.
+    if (!inFrame) {
+        BeginStreamingRegion();
+    }
 
-    glGenFramebuffers(1, &setFramebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, setFramebuffer);
+    // The runtime may change GL state on this context between frames, so the shadowed state is applied in full again once per pass.
+    ResetStateTracking();
+
+    // A vertex array must be bound to draw, even if the pipeline has no vertex inputs.
+    if (!emptyVertexArray) {
+        if (directStateAccess) {
+            glCreateVertexArrays(1, &emptyVertexArray);
+        } else {
+            glGenVertexArrays(1, &emptyVertexArray);
+        }
+    }
+    vertexArray = emptyVertexArray;
+    glBindVertexArray(vertexArray);
 }
 
 void GraphicsAPI_OpenGL::EndRendering() {
+    // The framebuffer stays in the cache for the next frame.
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glDeleteFramebuffers(1, &setFramebuffer);
     setFramebuffer = 0;
 
+    // The vertex arrays stay in the cache for the next frame.
     glBindVertexArray(0);
-    glDeleteVertexArrays(1, &vertexArray);
     vertexArray = 0;
+
+    if (!inFrame) {
+        EndStreamingRegion();
+    }
 }
 
-void GraphicsAPI_OpenGL::SetBufferData(void *buffer, size_t offset, size_t size, void *data) {
-    GLuint glBuffer = (GLuint)(uint64_t)buffer;
-    const BufferCreateInfo &bufferCI = buffers[glBuffer];
+void GraphicsAPI_OpenGL::SetBufferData(BufferHandle buffer, size_t offset, size_t size, void *data) {
+    const BufferResource &bufferResource = buffers[buffer];
+    GLuint glBuffer = bufferResource.buffer;
+    const BufferCreateInfo &bufferCI = bufferResource.bufferCI;
+    if (bufferResource.mappedData) {
+        if (data) {
+            WriteMappedBufferData(buffer, offset, size, data);
+        }
+        return;
+    }
 
     GLenum target = 0;
     if (bufferCI.type == BufferCreateInfo::Type::VERTEX) {
@@ -757,13 +1385,130 @@ void GraphicsAPI_OpenGL::SetBufferData(void *buffer, size_t offset, size_t size,
     }
 
     if (data) {
-        glBindBuffer(target, glBuffer);
-        glBufferSubData(target, (GLintptr)offset, (GLsizeiptr)size, data);
-        glBindBuffer(target, 0);
+        // Without buffer storage, a STREAM buffer is orphaned when it's rewritten in full, rather than waiting for the GPU to finish with the old contents.
+        bool orphan = bufferCI.usage == BufferCreateInfo::Usage::STREAM && offset == 0 && size == bufferCI.size;
+        if (directStateAccess) {
+            if (orphan) {
+                glNamedBufferData(glBuffer, (GLsizeiptr)size, data, GL_STREAM_DRAW);
+            } else {
+                glNamedBufferSubData(glBuffer, (GLintptr)offset, (GLsizeiptr)size, data);
+            }
+        } else {
+            glBindBuffer(target, glBuffer);
+            if (orphan) {
+                glBufferData(target, (GLsizeiptr)size, data, GL_STREAM_DRAW);
+            } else {
+                glBufferSubData(target, (GLintptr)offset, (GLsizeiptr)size, data);
+            }
+            glBindBuffer(target, 0);
+        }
+    }
+}
+
+void GraphicsAPI_OpenGL::WriteMappedBufferData(BufferHandle buffer, size_t offset, size_t size, const void *data) {
+    BufferResource &bufferResource = buffers[buffer];
+    if (bufferResource.regionFrameIndex != streamingFrameIndex) {
+        // On the first write in a frame, move to a region that no frame still in flight has bound. Each frame binds the buffer in at most
+        // one region until it's written, so while recording a frame, one region is always free.
+        uint32_t regionIndex = streamingRegionIndex;
+        bool regionFree = false;
+        for (uint32_t i = 0; i < streamingRegionCount && !regionFree; i++) {
+            regionIndex = (streamingRegionIndex + i) % streamingRegionCount;
+            regionFree = bufferResource.regionUseFrameIndices[regionIndex] + streamingRegionCount <= streamingFrameIndex;
+        }
+        if (!regionFree) {
+            // Between frames, the last streamingRegionCount frames may have used all of them. Wait for the oldest of those frames.
+            regionIndex = 0;
+            for (uint32_t i = 1; i < streamingRegionCount; i++) {
+                if (bufferResource.regionUseFrameIndices[i] < bufferResource.regionUseFrameIndices[regionIndex]) {
+                    regionIndex = i;
+                }
+            }
+            GLsync fence = streamingFences[bufferResource.regionUseFrameIndices[regionIndex] % streamingRegionCount];
+            if (fence && glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX) == GL_WAIT_FAILED) {
+                std::cout << "ERROR: OPENGL: Failed to wait for streaming buffer fence." << std::endl;
+            }
+        }
+
+        // The contents around the written range are carried over from the previous region.
+        if (regionIndex != bufferResource.regionIndex) {
+            uint8_t *dst = bufferResource.mappedData + regionIndex * bufferResource.regionSize;
+            const uint8_t *src = bufferResource.mappedData + bufferResource.regionIndex * bufferResource.regionSize;
+            memcpy(dst, src, offset);
+            memcpy(dst + offset + size, src + offset + size, bufferResource.bufferCI.size - (offset + size));
+        }
+        bufferResource.regionIndex = regionIndex;
+        bufferResource.regionFrameIndex = streamingFrameIndex;
+    }
+    memcpy(bufferResource.mappedData + bufferResource.regionIndex * bufferResource.regionSize + offset, data, size);
+}
+
+size_t GraphicsAPI_OpenGL::UseBuffer(BufferHandle buffer) {
+    // Records that the current frame uses the buffer's region, and returns the offset of that region.
+    BufferResource &bufferResource = buffers[buffer];
+    if (!bufferResource.mappedData) {
+        return 0;
+    }
+    bufferResource.regionUseFrameIndices[bufferResource.regionIndex] = streamingFrameIndex;
+    return bufferResource.regionIndex * bufferResource.regionSize;
+}
+
+GraphicsAPI::BufferHandle GraphicsAPI_OpenGL::AllocateUniformBufferData(size_t size, void *data, size_t &offset) {
+    if (!AllocateStreamingData(size, data, offset)) {
+        // The region is full, so the caller falls back to its own buffer.
+        return BufferHandle();
+    }
+    return streamingBufferHandle;
+}
+
+bool GraphicsAPI_OpenGL::AllocateStreamingData(size_t size, const void *data, size_t &offset) {
+    const size_t alignedOffset = Align<size_t>(streamingOffset, streamingOffsetAlignment);
+    if (alignedOffset + size > streamingRegionSize) {
+        return false;
+    }
+    streamingOffset = alignedOffset + size;
+
+    offset = streamingRegionIndex * streamingRegionSize + alignedOffset;
+    if (streamingBufferMappedData) {
+        memcpy(streamingBufferMappedData + offset, data, size);
+    } else if (directStateAccess) {
+        glNamedBufferSubData(streamingBuffer, (GLintptr)offset, (GLsizeiptr)size, data);
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, streamingBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr)offset, (GLsizeiptr)size, data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    return true;
+}
+
+void GraphicsAPI_OpenGL::FlushPushConstants() {
+    if (!pushConstantsDirty) {
+        return;
+    }
+    pushConstantsDirty = false;
+
+    // The whole block is streamed, as allocations are aligned to at least 256 bytes anyway.
+    GLuint buffer = streamingBuffer;
+    size_t offset = 0;
+    if (!AllocateStreamingData(maxPushConstantsSize, pushConstantsData, offset)) {
+        if (!pushConstantsBuffer) {
+            glGenBuffers(1, &pushConstantsBuffer);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, pushConstantsBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)maxPushConstantsSize, pushConstantsData, GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        buffer = pushConstantsBuffer;
+        offset = 0;
     }
+    glBindBufferRange(GL_UNIFORM_BUFFER, pushConstantsBindingIndex, buffer, (GLintptr)offset, (GLsizeiptr)maxPushConstantsSize);
 }
 
 void GraphicsAPI_OpenGL::ClearColor(void *imageView, float r, float g, float b, float a) {
+    if (directStateAccess) {
+        const GLfloat color[4] = {r, g, b, a};
+        glClearNamedFramebufferfv((GLuint)(uint64_t)imageView, GL_COLOR, 0, color);
+        return;
+    }
     glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)(uint64_t)imageView);
     glClearColor(r, g, b, a);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -771,63 +1516,75 @@ void GraphicsAPI_OpenGL::ClearColor(void *imageView, float r, float g, float b,
 }
 
 void GraphicsAPI_OpenGL::ClearDepth(void *imageView, float d) {
+    if (directStateAccess) {
+        glClearNamedFramebufferfv((GLuint)(uint64_t)imageView, GL_DEPTH, 0, &d);
+        return;
+    }
     glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)(uint64_t)imageView);
     glClearDepth(d);
     glClear(GL_DEPTH_BUFFER_BIT);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void GraphicsAPI_OpenGL::SetRenderAttachments(void **colorViews, size_t colorViewCount, void *depthStencilView, uint32_t width, uint32_t height, void *pipeline) {
-    // Reset Framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glDeleteFramebuffers(1, &setFramebuffer);
-    setFramebuffer = 0;
+void GraphicsAPI_OpenGL::AttachImageView(GLuint framebuffer, GLenum attachment, GLuint imageView) {
+    const ImageViewCreateInfo &imageViewCI = imageViews[imageView];
+    if (imageViewCI.view == ImageViewCreateInfo::View::TYPE_2D_ARRAY) {
+        // There's no named version of glFramebufferTextureMultiviewOVR(), so this uses the bound framebuffer.
+        glFramebufferTextureMultiviewOVR(GL_DRAW_FRAMEBUFFER, attachment, (GLuint)(uint64_t)imageViewCI.image, imageViewCI.baseMipLevel, imageViewCI.baseArrayLayer, imageViewCI.layerCount);
+    } else if (imageViewCI.view == ImageViewCreateInfo::View::TYPE_2D && directStateAccess) {
+        glNamedFramebufferTexture(framebuffer, attachment, (GLuint)(uint64_t)imageViewCI.image, imageViewCI.baseMipLevel);
+    } else if (imageViewCI.view == ImageViewCreateInfo::View::TYPE_2D) {
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, attachment, GL_TEXTURE_2D, (GLuint)(uint64_t)imageViewCI.image, imageViewCI.baseMipLevel);
+    } else {
+        DEBUG_BREAK;
+        std::cout << "ERROR: OPENGL: Unknown ImageView View type." << std::endl;
+    }
+}
+
+void GraphicsAPI_OpenGL::SetRenderAttachments(void **colorViews, size_t colorViewCount, void *depthStencilView, uint32_t width, uint32_t height, PipelineHandle pipeline) {
+    // Framebuffers are cached by their attachments: the color ImageViews followed by the depth ImageView, or 0 if there isn't one.
+    std::vector<GLuint> framebufferKey;
+    framebufferKey.reserve(colorViewCount + 1);
+    for (size_t i = 0; i < colorViewCount; i++) {
+        framebufferKey.push_back((GLuint)(uint64_t)colorViews[i]);
+    }
+    framebufferKey.push_back((GLuint)(uint64_t)depthStencilView);
+
+    auto it = framebufferCache.find(framebufferKey);
+    if (it != framebufferCache.end()) {
+        setFramebuffer = it->second;
+        glBindFramebuffer(GL_FRAMEBUFFER, setFramebuffer);
+        return;
+    }
 
-    glGenFramebuffers(1, &setFramebuffer);
+    // The framebuffer is bound for rendering anyway, so it's bound before attaching.
+    if (directStateAccess) {
+        glCreateFramebuffers(1, &setFramebuffer);
+    } else {
+        glGenFramebuffers(1, &setFramebuffer);
+    }
     glBindFramebuffer(GL_FRAMEBUFFER, setFramebuffer);
 
     // Color
     for (size_t i = 0; i < colorViewCount; i++) {
-        GLenum attachment = GL_COLOR_ATTACHMENT0;
-
-        GLuint glColorView = (GLuint)(uint64_t)colorViews[i];
-        const ImageViewCreateInfo &imageViewCI = imageViews[glColorView];
-
-        if (imageViewCI.view == ImageViewCreateInfo::View::TYPE_2D_ARRAY) {
-            glFramebufferTextureMultiviewOVR(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, (GLuint)(uint64_t)imageViewCI.image, imageViewCI.baseMipLevel, imageViewCI.baseArrayLayer, imageViewCI.layerCount);
-        } else if (imageViewCI.view == ImageViewCreateInfo::View::TYPE_2D) {
-            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, (GLuint)(uint64_t)imageViewCI.image, imageViewCI.baseMipLevel);
-        } else {
-            DEBUG_BREAK;
-            std::cout << "ERROR: OPENGL: Unknown ImageView View type." << std::endl;
-        }
+        AttachImageView(setFramebuffer, GL_COLOR_ATTACHMENT0 + (GLenum)i, framebufferKey[i]);
     }
     // DepthStencil
     if (depthStencilView) {
-        GLuint glDepthView = (GLuint)(uint64_t)depthStencilView;
-        const ImageViewCreateInfo &imageViewCI = imageViews[glDepthView];
-
-        if (imageViewCI.view == ImageViewCreateInfo::View::TYPE_2D_ARRAY) {
-            glFramebufferTextureMultiviewOVR(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, (GLuint)(uint64_t)imageViewCI.image, imageViewCI.baseMipLevel, imageViewCI.baseArrayLayer, imageViewCI.layerCount);
-        } else if (imageViewCI.view == ImageViewCreateInfo::View::TYPE_2D) {
-            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, (GLuint)(uint64_t)imageViewCI.image, imageViewCI.baseMipLevel);
-        } else {
-            DEBUG_BREAK;
-            std::cout << "ERROR: OPENGL: Unknown ImageView View type." << std::endl;
-        }
+        AttachImageView(setFramebuffer, GL_DEPTH_ATTACHMENT, framebufferKey.back());
     }
 
-    GLenum result = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+    // Completeness only needs checking once, as the attachments of a cached framebuffer never change.
+    GLenum result = directStateAccess ? glCheckNamedFramebufferStatus(setFramebuffer, GL_DRAW_FRAMEBUFFER) : glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
     if (result != GL_FRAMEBUFFER_COMPLETE) {
         DEBUG_BREAK;
         std::cout << "ERROR: OPENGL: Framebuffer is not complete." << std::endl;
     }
+
+    framebufferCache[framebufferKey] = setFramebuffer;
 }
 
 void GraphicsAPI_OpenGL::SetViewports(Viewport *viewports, size_t count) {
-    PFNGLVIEWPORTINDEXEDFPROC glViewportIndexedf = (PFNGLVIEWPORTINDEXEDFPROC)GetExtension("glViewportIndexedf");      // 4.1+
-    PFNGLDEPTHRANGEINDEXEDPROC glDepthRangeIndexed = (PFNGLDEPTHRANGEINDEXEDPROC)GetExtension("glDepthRangeIndexed");  // 4.1+
-
     for (size_t i = 0; i < count; i++) {
         Viewport viewport = viewports[i];
         glViewportIndexedf((GLuint)i, viewport.x, viewport.y, viewport.width, viewport.height);
@@ -836,226 +1593,207 @@ void GraphicsAPI_OpenGL::SetViewports(Viewport *viewports, size_t count) {
 }
 
 void GraphicsAPI_OpenGL::SetScissors(Rect2D *scissors, size_t count) {
-    PFNGLSCISSORINDEXEDPROC glScissorIndexed = (PFNGLSCISSORINDEXEDPROC)GetExtension("glScissorIndexed");  // 4.1+
-
     for (size_t i = 0; i < count; i++) {
         Rect2D scissor = scissors[i];
         glScissorIndexed((GLuint)i, (GLint)scissor.offset.x, (GLint)scissor.offset.y, (GLsizei)scissor.extent.width, (GLsizei)scissor.extent.height);
     }
 }
 
-void GraphicsAPI_OpenGL::SetPipeline(void *pipeline) {
-    GLuint program = (GLuint)(uint64_t)pipeline;
-    glUseProgram(program);
-    setPipeline = program;
+void GraphicsAPI_OpenGL::SetPipeline(PipelineHandle pipeline) {
+    setPipeline = pipeline;
+    const PipelineResource &pipelineResource = pipelines[setPipeline];
+    GLuint program = pipelineResource.program;
+    if (StateChanged(State::PROGRAM, 0, program)) {
+        glUseProgram(program);
+    }
 
-    const PipelineCreateInfo &pipelineCI = pipelines[program];
+    const PipelineCreateInfo &pipelineCI = pipelineResource.pipelineCI;
 
     // InputAssemblyState
     const InputAssemblyState &IAS = pipelineCI.inputAssemblyState;
-    if (IAS.primitiveRestartEnable) {
-        glEnable(GL_PRIMITIVE_RESTART);
-    } else {
-        glDisable(GL_PRIMITIVE_RESTART);
-    }
+    SetCapability(Capability::PRIMITIVE_RESTART, IAS.primitiveRestartEnable);
 
     // RasterisationState
     const RasterisationState &RS = pipelineCI.rasterisationState;
 
-    if (RS.depthClampEnable) {
-        glEnable(GL_DEPTH_CLAMP);
-    } else {
-        glDisable(GL_DEPTH_CLAMP);
-    }
+    SetCapability(Capability::DEPTH_CLAMP, RS.depthClampEnable);
 
-    if (RS.rasteriserDiscardEnable) {
-        glEnable(GL_RASTERIZER_DISCARD);
-    } else {
-        glDisable(GL_RASTERIZER_DISCARD);
-    }
+    SetCapability(Capability::RASTERIZER_DISCARD, RS.rasteriserDiscardEnable);
 
     if (RS.cullMode == CullMode::FRONT_AND_BACK) {
-        glPolygonMode(GL_FRONT_AND_BACK, ToGLPolygonMode(RS.polygonMode));
+        GLenum polygonMode = ToGLPolygonMode(RS.polygonMode);
+        if (StateChanged(State::POLYGON_MODE, 0, polygonMode)) {
+            glPolygonMode(GL_FRONT_AND_BACK, polygonMode);
+        }
     }
 
+    SetCapability(Capability::CULL_FACE, RS.cullMode > CullMode::NONE);
     if (RS.cullMode > CullMode::NONE) {
-        glEnable(GL_CULL_FACE);
-        glCullFace(ToGLCullMode(RS.cullMode));
-    } else {
-        glDisable(GL_CULL_FACE);
+        GLenum cullMode = ToGLCullMode(RS.cullMode);
+        if (StateChanged(State::CULL_FACE, 0, cullMode)) {
+            glCullFace(cullMode);
+        }
     }
 
-    glFrontFace(RS.frontFace == FrontFace::COUNTER_CLOCKWISE ? GL_CCW : GL_CW);
+    GLenum frontFace = RS.frontFace == FrontFace::COUNTER_CLOCKWISE ? GL_CCW : GL_CW;
+    if (StateChanged(State::FRONT_FACE, 0, frontFace)) {
+        glFrontFace(frontFace);
+    }
 
-    GLenum polygonOffsetMode = 0;
+    Capability polygonOffsetMode = Capability::POLYGON_OFFSET_FILL;
     switch (RS.polygonMode) {
     default:
     case PolygonMode::FILL: {
-        polygonOffsetMode = GL_POLYGON_OFFSET_FILL;
+        polygonOffsetMode = Capability::POLYGON_OFFSET_FILL;
         break;
     }
     case PolygonMode::LINE: {
-        polygonOffsetMode = GL_POLYGON_OFFSET_LINE;
+        polygonOffsetMode = Capability::POLYGON_OFFSET_LINE;
         break;
     }
     case PolygonMode::POINT: {
-        polygonOffsetMode = GL_POLYGON_OFFSET_POINT;
+        polygonOffsetMode = Capability::POLYGON_OFFSET_POINT;
         break;
     }
     }
+    SetCapability(polygonOffsetMode, RS.depthBiasEnable);
     if (RS.depthBiasEnable) {
-        glEnable(polygonOffsetMode);
         // glPolygonOffsetClamp
-        glPolygonOffset(RS.depthBiasSlopeFactor, RS.depthBiasConstantFactor);
-    } else {
-        glDisable(polygonOffsetMode);
+        if (StateChanged(State::POLYGON_OFFSET, 0, FloatBits(RS.depthBiasSlopeFactor), FloatBits(RS.depthBiasConstantFactor))) {
+            glPolygonOffset(RS.depthBiasSlopeFactor, RS.depthBiasConstantFactor);
+        }
     }
 
-    glLineWidth(RS.lineWidth);
+    if (StateChanged(State::LINE_WIDTH, 0, FloatBits(RS.lineWidth))) {
+        glLineWidth(RS.lineWidth);
+    }
 
     // MultisampleState
     const MultisampleState &MS = pipelineCI.multisampleState;
 
-    if (MS.rasterisationSamples > 1) {
-        glEnable(GL_MULTISAMPLE);
-    } else {
-        glDisable(GL_MULTISAMPLE);
-    }
+    SetCapability(Capability::MULTISAMPLE, MS.rasterisationSamples > 1);
 
+    SetCapability(Capability::SAMPLE_SHADING, MS.sampleShadingEnable);
     if (MS.sampleShadingEnable) {
-        glEnable(GL_SAMPLE_SHADING);
-        PFNGLMINSAMPLESHADINGPROC glMinSampleShading = (PFNGLMINSAMPLESHADINGPROC)GetExtension("glMinSampleShading");  // 4.0+
-        glMinSampleShading(MS.minSampleShading);
-    } else {
-        glDisable(GL_SAMPLE_SHADING);
+        if (StateChanged(State::MIN_SAMPLE_SHADING, 0, FloatBits(MS.minSampleShading))) {
+            glMinSampleShading(MS.minSampleShading);
+        }
     }
 
+    SetCapability(Capability::SAMPLE_MASK, MS.sampleMask > 0);
     if (MS.sampleMask > 0) {
-        glEnable(GL_SAMPLE_MASK);
-        PFNGLSAMPLEMASKIPROC glSampleMaski = (PFNGLSAMPLEMASKIPROC)GetExtension("glSampleMaski");  // 3.2+
-        glSampleMaski(0, MS.sampleMask);
-    } else {
-        glDisable(GL_SAMPLE_MASK);
+        if (StateChanged(State::SAMPLE_MASK, 0, MS.sampleMask)) {
+            glSampleMaski(0, MS.sampleMask);
+        }
     }
 
-    if (MS.alphaToCoverageEnable) {
-        glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE);
-    } else {
-        glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
-    }
+    SetCapability(Capability::SAMPLE_ALPHA_TO_COVERAGE, MS.alphaToCoverageEnable);
 
-    if (MS.alphaToOneEnable) {
-        glEnable(GL_SAMPLE_ALPHA_TO_ONE);
-    } else {
-        glDisable(GL_SAMPLE_ALPHA_TO_ONE);
-    }
+    SetCapability(Capability::SAMPLE_ALPHA_TO_ONE, MS.alphaToOneEnable);
 
     // DepthStencilState
     const DepthStencilState &DSS = pipelineCI.depthStencilState;
 
-    if (DSS.depthTestEnable) {
-        glEnable(GL_DEPTH_TEST);
-    } else {
-        glDisable(GL_DEPTH_TEST);
-    }
+    SetCapability(Capability::DEPTH_TEST, DSS.depthTestEnable);
 
-    glDepthMask(DSS.depthWriteEnable ? GL_TRUE : GL_FALSE);
+    if (StateChanged(State::DEPTH_MASK, 0, DSS.depthWriteEnable)) {
+        glDepthMask(DSS.depthWriteEnable ? GL_TRUE : GL_FALSE);
+    }
 
-    glDepthFunc(ToGLCompareOp(DSS.depthCompareOp));
+    GLenum depthFunc = ToGLCompareOp(DSS.depthCompareOp);
+    if (StateChanged(State::DEPTH_FUNC, 0, depthFunc)) {
+        glDepthFunc(depthFunc);
+    }
 
-    PFNGLDEPTHBOUNDSEXTPROC glDepthBoundsEXT = (PFNGLDEPTHBOUNDSEXTPROC)GetExtension("glDepthBoundsEXT");  // EXT
     if (glDepthBoundsEXT) {
+        SetCapability(Capability::DEPTH_BOUNDS_TEST, DSS.depthBoundsTestEnable);
         if (DSS.depthBoundsTestEnable) {
-            glEnable(GL_DEPTH_BOUNDS_TEST_EXT);
-            glDepthBoundsEXT(DSS.minDepthBounds, DSS.maxDepthBounds);
-        } else {
-            glDisable(GL_DEPTH_BOUNDS_TEST_EXT);
+            if (StateChanged(State::DEPTH_BOUNDS, 0, FloatBits(DSS.minDepthBounds), FloatBits(DSS.maxDepthBounds))) {
+                glDepthBoundsEXT(DSS.minDepthBounds, DSS.maxDepthBounds);
+            }
         }
     }
 
-    if (DSS.stencilTestEnable) {
-        glEnable(GL_STENCIL_TEST);
-    } else {
-        glDisable(GL_STENCIL_TEST);
-    }
-
-    PFNGLSTENCILOPSEPARATEPROC glStencilOpSeparate = (PFNGLSTENCILOPSEPARATEPROC)GetExtension("glStencilOpSeparate");          // 2.0+
-    PFNGLSTENCILFUNCSEPARATEPROC glStencilFuncSeparate = (PFNGLSTENCILFUNCSEPARATEPROC)GetExtension("glStencilFuncSeparate");  // 2.0+
-    PFNGLSTENCILMASKSEPARATEPROC glStencilMaskSeparate = (PFNGLSTENCILMASKSEPARATEPROC)GetExtension("glStencilMaskSeparate");  // 2.0+
-
-    glStencilOpSeparate(GL_FRONT,
-                        ToGLStencilCompareOp(DSS.front.failOp),
-                        ToGLStencilCompareOp(DSS.front.depthFailOp),
-                        ToGLStencilCompareOp(DSS.front.passOp));
-    glStencilFuncSeparate(GL_FRONT,
-                          ToGLCompareOp(DSS.front.compareOp),
-                          DSS.front.reference,
-                          DSS.front.compareMask);
-    glStencilMaskSeparate(GL_FRONT, DSS.front.writeMask);
-
-    glStencilOpSeparate(GL_BACK,
-                        ToGLStencilCompareOp(DSS.back.failOp),
-                        ToGLStencilCompareOp(DSS.back.depthFailOp),
-                        ToGLStencilCompareOp(DSS.back.passOp));
-    glStencilFuncSeparate(GL_BACK,
-                          ToGLCompareOp(DSS.back.compareOp),
-                          DSS.back.reference,
-                          DSS.back.compareMask);
-    glStencilMaskSeparate(GL_BACK, DSS.back.writeMask);
+    SetCapability(Capability::STENCIL_TEST, DSS.stencilTestEnable);
+
+    const StencilOpState *stencilOpStates[2] = {&DSS.front, &DSS.back};
+    const GLenum stencilFaces[2] = {GL_FRONT, GL_BACK};
+    for (GLuint i = 0; i < 2; i++) {
+        const StencilOpState &SOS = *stencilOpStates[i];
+        GLenum failOp = ToGLStencilCompareOp(SOS.failOp);
+        GLenum depthFailOp = ToGLStencilCompareOp(SOS.depthFailOp);
+        GLenum passOp = ToGLStencilCompareOp(SOS.passOp);
+        if (StateChanged(State::STENCIL_OP, i, failOp, depthFailOp, passOp)) {
+            glStencilOpSeparate(stencilFaces[i], failOp, depthFailOp, passOp);
+        }
+        GLenum compareOp = ToGLCompareOp(SOS.compareOp);
+        if (StateChanged(State::STENCIL_FUNC, i, compareOp, SOS.reference, SOS.compareMask)) {
+            glStencilFuncSeparate(stencilFaces[i], compareOp, SOS.reference, SOS.compareMask);
+        }
+        if (StateChanged(State::STENCIL_MASK, i, SOS.writeMask)) {
+            glStencilMaskSeparate(stencilFaces[i], SOS.writeMask);
+        }
+    }
 
     // ColorBlendState
     const ColorBlendState &CBS = pipelineCI.colorBlendState;
 
+    SetCapability(Capability::COLOR_LOGIC_OP, CBS.logicOpEnable);
     if (CBS.logicOpEnable) {
-        glEnable(GL_COLOR_LOGIC_OP);
-        glLogicOp(ToGLLogicOp(CBS.logicOp));
-    } else {
-        glDisable(GL_COLOR_LOGIC_OP);
+        GLenum logicOp = ToGLLogicOp(CBS.logicOp);
+        if (StateChanged(State::LOGIC_OP, 0, logicOp)) {
+            glLogicOp(logicOp);
+        }
     }
 
     for (int i = 0; i < (int)CBS.attachments.size(); i++) {
         const ColorBlendAttachmentState &CBA = CBS.attachments[i];
 
-        PFNGLENABLEIPROC glEnablei = (PFNGLENABLEIPROC)GetExtension("glEnablei");                                                              // 3.0+
-        PFNGLDISABLEIPROC glDisablei = (PFNGLDISABLEIPROC)GetExtension("glDisablei");                                                          // 3.0+
-        PFNGLBLENDEQUATIONSEPARATEIPROC glBlendEquationSeparatei = (PFNGLBLENDEQUATIONSEPARATEIPROC)GetExtension("glBlendEquationSeparatei");  // 4.0+
-        PFNGLBLENDFUNCSEPARATEIPROC glBlendFuncSeparatei = (PFNGLBLENDFUNCSEPARATEIPROC)GetExtension("glBlendFuncSeparatei");                  // 4.0+
-        PFNGLCOLORMASKIPROC glColorMaski = (PFNGLCOLORMASKIPROC)GetExtension("glColorMaski");                                                  // 3.0+
+        SetCapabilityIndexed(GL_BLEND, (GLuint)i, CBA.blendEnable);
 
-        if (CBA.blendEnable) {
-            glEnablei(GL_BLEND, i);
-        } else {
-            glDisablei(GL_BLEND, i);
+        GLenum colorBlendOp = ToGLBlendOp(CBA.colorBlendOp);
+        GLenum alphaBlendOp = ToGLBlendOp(CBA.alphaBlendOp);
+        if (StateChanged(State::BLEND_EQUATION, (GLuint)i, colorBlendOp, alphaBlendOp)) {
+            glBlendEquationSeparatei(i, colorBlendOp, alphaBlendOp);
         }
 
-        glBlendEquationSeparatei(i, ToGLBlendOp(CBA.colorBlendOp), ToGLBlendOp(CBA.alphaBlendOp));
-
-        glBlendFuncSeparatei(i,
-                             ToGLBlendFactor(CBA.srcColorBlendFactor),
-                             ToGLBlendFactor(CBA.dstColorBlendFactor),
-                             ToGLBlendFactor(CBA.srcAlphaBlendFactor),
-                             ToGLBlendFactor(CBA.dstAlphaBlendFactor));
+        GLenum srcColorBlendFactor = ToGLBlendFactor(CBA.srcColorBlendFactor);
+        GLenum dstColorBlendFactor = ToGLBlendFactor(CBA.dstColorBlendFactor);
+        GLenum srcAlphaBlendFactor = ToGLBlendFactor(CBA.srcAlphaBlendFactor);
+        GLenum dstAlphaBlendFactor = ToGLBlendFactor(CBA.dstAlphaBlendFactor);
+        if (StateChanged(State::BLEND_FUNC, (GLuint)i, srcColorBlendFactor, dstColorBlendFactor, srcAlphaBlendFactor, dstAlphaBlendFactor)) {
+            glBlendFuncSeparatei(i, srcColorBlendFactor, dstColorBlendFactor, srcAlphaBlendFactor, dstAlphaBlendFactor);
+        }
 
-        glColorMaski(i,
-                     (((uint32_t)CBA.colorWriteMask & (uint32_t)ColorComponentBit::R_BIT) == (uint32_t)ColorComponentBit::R_BIT),
-                     (((uint32_t)CBA.colorWriteMask & (uint32_t)ColorComponentBit::G_BIT) == (uint32_t)ColorComponentBit::G_BIT),
-                     (((uint32_t)CBA.colorWriteMask & (uint32_t)ColorComponentBit::B_BIT) == (uint32_t)ColorComponentBit::B_BIT),
-                     (((uint32_t)CBA.colorWriteMask & (uint32_t)ColorComponentBit::A_BIT) == (uint32_t)ColorComponentBit::A_BIT));
+        if (StateChanged(State::COLOR_MASK, (GLuint)i, (uint64_t)CBA.colorWriteMask)) {
+            glColorMaski(i,
+                         (((uint32_t)CBA.colorWriteMask & (uint32_t)ColorComponentBit::R_BIT) == (uint32_t)ColorComponentBit::R_BIT),
+                         (((uint32_t)CBA.colorWriteMask & (uint32_t)ColorComponentBit::G_BIT) == (uint32_t)ColorComponentBit::G_BIT),
+                         (((uint32_t)CBA.colorWriteMask & (uint32_t)ColorComponentBit::B_BIT) == (uint32_t)ColorComponentBit::B_BIT),
+                         (((uint32_t)CBA.colorWriteMask & (uint32_t)ColorComponentBit::A_BIT) == (uint32_t)ColorComponentBit::A_BIT));
+        }
+    }
+    if (StateChanged(State::BLEND_COLOR, 0, FloatBits(CBS.blendConstants[0]), FloatBits(CBS.blendConstants[1]), FloatBits(CBS.blendConstants[2]), FloatBits(CBS.blendConstants[3]))) {
+        glBlendColor(CBS.blendConstants[0], CBS.blendConstants[1], CBS.blendConstants[2], CBS.blendConstants[3]);
     }
-    glBlendColor(CBS.blendConstants[0], CBS.blendConstants[1], CBS.blendConstants[2], CBS.blendConstants[3]);
 }
 
 void GraphicsAPI_OpenGL::SetDescriptor(const DescriptorInfo &descriptorInfo) {
     GLuint glResource = (GLuint)(uint64_t)descriptorInfo.resource;
     const GLuint &bindingIndex = descriptorInfo.bindingIndex;
     if (descriptorInfo.type == DescriptorInfo::Type::BUFFER) {
-        PFNGLBINDBUFFERRANGEPROC glBindBufferRange = (PFNGLBINDBUFFERRANGEPROC)GetExtension("glBindBufferRange");  // 3.0+
-        glBindBufferRange(GL_UNIFORM_BUFFER, bindingIndex, glResource, (GLintptr)descriptorInfo.bufferOffset, (GLsizeiptr)descriptorInfo.bufferSize);
+        BufferHandle buffer = BufferHandle::FromPointer(descriptorInfo.resource);
+        glResource = buffers[buffer].buffer;
+        const size_t regionOffset = UseBuffer(buffer);
+        if (setUniformBuffers.size() <= bindingIndex) {
+            setUniformBuffers.resize(bindingIndex + 1);
+        }
+        setUniformBuffers[bindingIndex] = buffer;
+        glBindBufferRange(GL_UNIFORM_BUFFER, bindingIndex, glResource, (GLintptr)(regionOffset + descriptorInfo.bufferOffset), (GLsizeiptr)descriptorInfo.bufferSize);
     } else if (descriptorInfo.type == DescriptorInfo::Type::IMAGE) {
         glActiveTexture(GL_TEXTURE0 + bindingIndex);
-        glBindTexture(GetGLTextureTarget(images[glResource]), glResource);
+        glBindTexture(glResource < imageTargets.size() && imageTargets[glResource] ? imageTargets[glResource] : GL_TEXTURE_2D, glResource);
     } else if (descriptorInfo.type == DescriptorInfo::Type::SAMPLER) {
-        PFNGLBINDSAMPLERPROC glBindSampler = (PFNGLBINDSAMPLERPROC)GetExtension("glBindSampler");  // 3.0+
         glBindSampler(bindingIndex, glResource);
     } else {
         std::cout << "ERROR: OPENGL: Unknown Descriptor Type." << std::endl;
@@ -1065,15 +1803,88 @@ void GraphicsAPI_OpenGL::SetDescriptor(const DescriptorInfo &descriptorInfo) {
 void GraphicsAPI_OpenGL::UpdateDescriptors() {
 }
 
-void GraphicsAPI_OpenGL::SetVertexBuffers(void **vertexBuffers, size_t count) {
-    const VertexInputState &vertexInputState = pipelines[setPipeline].vertexInputState;
+void GraphicsAPI_OpenGL::SetPushConstants(DescriptorInfo::Stage stage, uint32_t offset, uint32_t size, const void *data) {
+    if (offset + size > maxPushConstantsSize) {
+        std::cout << "ERROR: OPENGL: Push constants exceed " << maxPushConstantsSize << " bytes." << std::endl;
+        DEBUG_BREAK;
+        return;
+    }
+    memcpy(pushConstantsData + offset, data, size);
+    pushConstantsDirty = true;
+}
+
+void GraphicsAPI_OpenGL::SetVertexBuffers(BufferHandle *vertexBuffers, size_t count) {
+    const VertexInputState &vertexInputState = pipelines[setPipeline].pipelineCI.vertexInputState;
+
+    // Vertex arrays are cached by the pipeline's vertex layout and the vertex buffers, so pipelines with the same layout share them.
+    // The offsets of the buffers' current regions are part of the layout.
+    std::pair<std::vector<uint64_t>, std::vector<GLuint>> vertexArrayKey;
+    std::vector<uint64_t> &vertexLayout = vertexArrayKey.first;
+    vertexLayout.reserve(2 + 3 * vertexInputState.bindings.size() + 4 * vertexInputState.attributes.size() + count);
+    vertexLayout.push_back(vertexInputState.bindings.size());
+    for (const VertexInputBinding &vertexBinding : vertexInputState.bindings) {
+        vertexLayout.push_back(vertexBinding.bindingIndex);
+        vertexLayout.push_back(vertexBinding.stride);
+        vertexLayout.push_back((uint64_t)vertexBinding.inputRate);
+    }
+    vertexLayout.push_back(vertexInputState.attributes.size());
+    for (const VertexInputAttribute &vertexAttribute : vertexInputState.attributes) {
+        vertexLayout.push_back(vertexAttribute.attribIndex);
+        vertexLayout.push_back(vertexAttribute.bindingIndex);
+        vertexLayout.push_back((uint64_t)vertexAttribute.vertexType);
+        vertexLayout.push_back(vertexAttribute.offset);
+    }
+    std::vector<GLuint> &glVertexBuffers = vertexArrayKey.second;
     for (size_t i = 0; i < count; i++) {
-        GLuint glVertexBufferID = (GLuint)(uint64_t)vertexBuffers[i];
-        if (buffers[glVertexBufferID].type != BufferCreateInfo::Type::VERTEX) {
+        const BufferResource &bufferResource = buffers[vertexBuffers[i]];
+        if (bufferResource.bufferCI.type != BufferCreateInfo::Type::VERTEX) {
             std::cout << "ERROR: OpenGL: Provided buffer is not type: VERTEX." << std::endl;
         }
+        glVertexBuffers.push_back(bufferResource.buffer);
+        vertexLayout.push_back(UseBuffer(vertexBuffers[i]));
+    }
+    const uint64_t *regionOffsets = vertexLayout.data() + vertexLayout.size() - count;
+
+    auto it = vertexArrayCache.find(vertexArrayKey);
+    if (it != vertexArrayCache.end()) {
+        vertexArray = it->second;
+        glBindVertexArray(vertexArray);
+        return;
+    }
+
+    if (directStateAccess) {
+        glCreateVertexArrays(1, &vertexArray);
+        for (size_t i = 0; i < count; i++) {
+            GLuint glVertexBufferID = glVertexBuffers[i];
+            for (const VertexInputBinding &vertexBinding : vertexInputState.bindings) {
+                if (vertexBinding.bindingIndex == (uint32_t)i) {
+                    glVertexArrayVertexBuffer(vertexArray, (GLuint)i, glVertexBufferID, (GLintptr)regionOffsets[i], (GLsizei)vertexBinding.stride);
+                    glVertexArrayBindingDivisor(vertexArray, (GLuint)i, vertexBinding.inputRate == VertexInputRate::INSTANCE ? 1 : 0);
+                    for (const VertexInputAttribute &vertexAttribute : vertexInputState.attributes) {
+                        if (vertexAttribute.bindingIndex == (uint32_t)i) {
+                            GLuint attribIndex = vertexAttribute.attribIndex;
+                            GLint size = ((GLint)vertexAttribute.vertexType % 4) + 1;
+                            GLenum type = (GLenum)vertexAttribute.vertexType >= (GLenum)VertexType::UINT ? GL_UNSIGNED_INT : (GLenum)vertexAttribute.vertexType >= (GLenum)VertexType::INT ? GL_INT
+                                                                                                                                                                                           : GL_FLOAT;
+                            glEnableVertexArrayAttrib(vertexArray, attribIndex);
+                            glVertexArrayAttribFormat(vertexArray, attribIndex, size, type, GL_FALSE, (GLuint)vertexAttribute.offset);
+                            glVertexArrayAttribBinding(vertexArray, attribIndex, (GLuint)i);
+                        }
+                    }
+                }
+            }
+        }
+        glBindVertexArray(vertexArray);
+
+        vertexArrayCache[vertexArrayKey] = vertexArray;
+        return;
+    }
 
-        glBindBuffer(GL_ARRAY_BUFFER, (GLuint)(uint64_t)vertexBuffers[i]);
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+
+    for (size_t i = 0; i < count; i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, glVertexBuffers[i]);
 
         // https://i.redd.it/fyxp5ah06a661.png
         for (const VertexInputBinding &vertexBinding : vertexInputState.bindings) {
@@ -1085,34 +1896,73 @@ void GraphicsAPI_OpenGL::SetVertexBuffers(void **vertexBuffers, size_t count) {
                         GLenum type = (GLenum)vertexAttribute.vertexType >= (GLenum)VertexType::UINT ? GL_UNSIGNED_INT : (GLenum)vertexAttribute.vertexType >= (GLenum)VertexType::INT ? GL_INT
                                                                                                                                                                                        : GL_FLOAT;
                         GLsizei stride = vertexBinding.stride;
-                        const void *offset = (const void *)vertexAttribute.offset;
+                        const void *offset = (const void *)(regionOffsets[i] + vertexAttribute.offset);
                         glEnableVertexAttribArray(attribIndex);
                         glVertexAttribPointer(attribIndex, size, type, false, stride, offset);
+                        glVertexAttribDivisor(attribIndex, vertexBinding.inputRate == VertexInputRate::INSTANCE ? 1 : 0);
                     }
                 }
             }
         }
     }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    vertexArrayCache[vertexArrayKey] = vertexArray;
 }
 
-void GraphicsAPI_OpenGL::SetIndexBuffer(void *indexBuffer) {
-    GLuint glIndexBufferID = (GLuint)(uint64_t)indexBuffer;
-    if (buffers[glIndexBufferID].type != BufferCreateInfo::Type::INDEX) {
+void GraphicsAPI_OpenGL::SetIndexBuffer(BufferHandle indexBuffer) {
+    setIndexBuffer = indexBuffer;
+    const BufferResource &bufferResource = buffers[setIndexBuffer];
+    GLuint glIndexBufferID = bufferResource.buffer;
+    if (bufferResource.bufferCI.type != BufferCreateInfo::Type::INDEX) {
         std::cout << "ERROR: OpenGL: Provided buffer is not type: INDEX." << std::endl;
     }
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, glIndexBufferID);
-    setIndexBuffer = glIndexBufferID;
+    setIndexBufferOffset = UseBuffer(setIndexBuffer);
+    // The index buffer binding is part of the vertex array's state, so it's rebound onto whichever vertex array is current.
+    if (directStateAccess) {
+        glVertexArrayElementBuffer(vertexArray, glIndexBufferID);
+    } else {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, glIndexBufferID);
+    }
 }
 
 void GraphicsAPI_OpenGL::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) {
-    PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC glDrawElementsInstancedBaseVertexBaseInstance = (PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC)GetExtension("glDrawElementsInstancedBaseVertexBaseInstance");  // 4.2+
-    GLenum indexType = buffers[setIndexBuffer].stride == 4 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
-    glDrawElementsInstancedBaseVertexBaseInstance(ToGLTopology(pipelines[setPipeline].inputAssemblyState.topology), indexCount, indexType, nullptr, instanceCount, vertexOffset, firstInstance);
+    FlushPushConstants();
+    const size_t indexSize = buffers[setIndexBuffer].bufferCI.stride == 4 ? 4 : 2;
+    GLenum indexType = indexSize == 4 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+    const void *indices = (const void *)(setIndexBufferOffset + firstIndex * indexSize);
+    glDrawElementsInstancedBaseVertexBaseInstance(ToGLTopology(pipelines[setPipeline].pipelineCI.inputAssemblyState.topology), indexCount, indexType, indices, instanceCount, vertexOffset, firstInstance);
+}
+
+void GraphicsAPI_OpenGL::MultiDrawIndexedIndirect(const DrawIndexedIndirectCommand *commands, uint32_t drawCount) {
+    const size_t indexSize = buffers[setIndexBuffer].bufferCI.stride == 4 ? 4 : 2;
+    GLenum indexType = indexSize == 4 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+
+    // firstIndex is relative to the start of the index buffer, so it's moved into the index buffer's current region.
+    std::vector<DrawIndexedIndirectCommand> regionCommands;
+    if (multiDrawIndirect && setIndexBufferOffset) {
+        regionCommands.assign(commands, commands + drawCount);
+        for (DrawIndexedIndirectCommand &command : regionCommands) {
+            command.firstIndex += static_cast<uint32_t>(setIndexBufferOffset / indexSize);
+        }
+    }
+
+    // The commands go into the streaming buffer, which is bound as the indirect buffer for the draw.
+    size_t offset = 0;
+    if (!multiDrawIndirect || !AllocateStreamingData(sizeof(DrawIndexedIndirectCommand) * drawCount, regionCommands.empty() ? commands : regionCommands.data(), offset)) {
+        GraphicsAPI::MultiDrawIndexedIndirect(commands, drawCount);
+        return;
+    }
+    FlushPushConstants();
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, streamingBuffer);
+    glMultiDrawElementsIndirect(ToGLTopology(pipelines[setPipeline].pipelineCI.inputAssemblyState.topology), indexType, (const void *)offset, (GLsizei)drawCount, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 }
 
 void GraphicsAPI_OpenGL::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) {
-    PFNGLDRAWARRAYSINSTANCEDBASEINSTANCEPROC glDrawArraysInstancedBaseInstance = (PFNGLDRAWARRAYSINSTANCEDBASEINSTANCEPROC)GetExtension("glDrawArraysInstancedBaseInstance");  // 4.2+
-    glDrawArraysInstancedBaseInstance(ToGLTopology(pipelines[setPipeline].inputAssemblyState.topology), firstVertex, vertexCount, instanceCount, firstInstance);
+    FlushPushConstants();
+    glDrawArraysInstancedBaseInstance(ToGLTopology(pipelines[setPipeline].pipelineCI.inputAssemblyState.topology), firstVertex, vertexCount, instanceCount, firstInstance);
 }
 
 // XR_DOCS_TAG_BEGIN_GraphicsAPI_OpenGL_GetSupportedSwapchainFormats
@@ -7,8 +7,11 @@
 #pragma once
 #include <GraphicsAPI.h>
 
+#include <array>
+#include <map>
+
 #if defined(XR_USE_GRAPHICS_API_OPENGL)
-class GraphicsAPI_OpenGL : public GraphicsAPI {
+class GraphicsAPI_OpenGL final : public GraphicsAPI {
 public:
     GraphicsAPI_OpenGL();
     GraphicsAPI_OpenGL(XrInstance m_xrInstance, XrSystemId systemId);
@@ -23,6 +26,7 @@ public:
     // XR_DOCS_TAG_BEGIN_GetDepthFormat_OpenGL
     virtual int64_t GetDepthFormat() override { return (int64_t)GL_DEPTH_COMPONENT32F; }
     // XR_DOCS_TAG_END_GetDepthFormat_OpenGL
+    virtual size_t AlignSizeForUniformBuffer(size_t size) override { return Align<size_t>(size, uniformBufferOffsetAlignment); }
 
     virtual void* GetGraphicsBinding() override;
     virtual XrSwapchainImageBaseHeader* AllocateSwapchainImageData(XrSwapchain swapchain, SwapchainType type, uint32_t count) override;
@@ -44,42 +48,144 @@ public:
     virtual void* CreateSampler(const SamplerCreateInfo& samplerCI) override;
     virtual void DestroySampler(void*& sampler) override;
 
-    virtual void* CreateBuffer(const BufferCreateInfo& bufferCI) override;
-    virtual void DestroyBuffer(void*& buffer) override;
+    virtual BufferHandle CreateBuffer(const BufferCreateInfo& bufferCI) override;
+    virtual void DestroyBuffer(BufferHandle& buffer) override;
 
     virtual void* CreateShader(const ShaderCreateInfo& shaderCI) override;
     virtual void DestroyShader(void*& shader) override;
 
-    virtual void* CreatePipeline(const PipelineCreateInfo& pipelineCI) override;
-    virtual void DestroyPipeline(void*& pipeline) override;
+    virtual PipelineHandle CreatePipeline(const PipelineCreateInfo& pipelineCI) override;
+    virtual void DestroyPipeline(PipelineHandle& pipeline) override;
+
+    virtual void BeginFrame() override;
+    virtual void EndFrame() override;
 
     virtual void BeginRendering() override;
     virtual void EndRendering() override;
 
-    virtual void SetBufferData(void* buffer, size_t offset, size_t size, void* data) override;
+    virtual void SetBufferData(BufferHandle buffer, size_t offset, size_t size, void* data) override;
+    virtual BufferHandle AllocateUniformBufferData(size_t size, void* data, size_t& offset) override;
 
     virtual void ClearColor(void* imageView, float r, float g, float b, float a) override;
     virtual void ClearDepth(void* imageView, float d) override;
 
-    virtual void SetRenderAttachments(void** colorViews, size_t colorViewCount, void* depthStencilView, uint32_t width, uint32_t height, void* pipeline) override;
+    virtual void SetRenderAttachments(void** colorViews, size_t colorViewCount, void* depthStencilView, uint32_t width, uint32_t height, PipelineHandle pipeline) override;
     virtual void SetViewports(Viewport* viewports, size_t count) override;
     virtual void SetScissors(Rect2D* scissors, size_t count) override;
 
-    virtual void SetPipeline(void* pipeline) override;
+    virtual void SetPipeline(PipelineHandle pipeline) override;
     virtual void SetDescriptor(const DescriptorInfo& descriptorInfo) override;
     virtual void UpdateDescriptors() override;
-    virtual void SetVertexBuffers(void** vertexBuffers, size_t count) override;
-    virtual void SetIndexBuffer(void* indexBuffer) override;
+    virtual void SetPushConstants(DescriptorInfo::Stage stage, uint32_t offset, uint32_t size, const void* data) override;
+    virtual void SetVertexBuffers(BufferHandle* vertexBuffers, size_t count) override;
+    virtual void SetIndexBuffer(BufferHandle indexBuffer) override;
     virtual void DrawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t firstInstance = 0) override;
     virtual void Draw(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0) override;
 
+    virtual bool IsMultiDrawIndexedIndirectSupported() override { return multiDrawIndirect; }
+    virtual void MultiDrawIndexedIndirect(const DrawIndexedIndirectCommand* commands, uint32_t drawCount) override;
+
+    // Writes the program binary cache to disk, if it changed. This is also done in the destructor.
+    void SaveProgramBinaryCache();
+
+    // Number of GL state calls that SetPipeline() skipped, because the state was already applied.
+    uint64_t GetSkippedStateChangeCount() const { return skippedStateChangeCount; }
+
 private:
+    void LoadFunctions();
+    bool IsVersionSupported(GLint major, GLint minor);
+    bool IsExtensionSupported(const char* extensionName);
+
+    void CreateStreamingBuffer();
+    void DestroyStreamingBuffer();
+    void BeginStreamingRegion();
+    void EndStreamingRegion();
+    bool AllocateStreamingData(size_t size, const void* data, size_t& offset);
+    void WriteMappedBufferData(BufferHandle buffer, size_t offset, size_t size, const void* data);
+    size_t UseBuffer(BufferHandle buffer);
+    void FlushPushConstants();
+
+    void LoadProgramBinaryCache();
+    bool CompileShader(GLuint shader);
+
+    void AttachImageView(GLuint framebuffer, GLenum attachment, GLuint imageView);
+
+    // Shadowed GL state, so that only the state that differs from the currently applied state is set. The shadow is a fixed array
+    // indexed by the state, and by the stencil face or color attachment for per-face and per-attachment state.
+    enum class Capability : uint8_t {
+        PRIMITIVE_RESTART,
+        DEPTH_CLAMP,
+        RASTERIZER_DISCARD,
+        CULL_FACE,
+        POLYGON_OFFSET_FILL,
+        POLYGON_OFFSET_LINE,
+        POLYGON_OFFSET_POINT,
+        MULTISAMPLE,
+        SAMPLE_SHADING,
+        SAMPLE_MASK,
+        SAMPLE_ALPHA_TO_COVERAGE,
+        SAMPLE_ALPHA_TO_ONE,
+        DEPTH_TEST,
+        DEPTH_BOUNDS_TEST,
+        STENCIL_TEST,
+        COLOR_LOGIC_OP,
+        COUNT
+    };
+    enum class State : uint8_t {
+        PROGRAM,
+        CAPABILITY_INDEXED,
+        POLYGON_MODE,
+        CULL_FACE,
+        FRONT_FACE,
+        POLYGON_OFFSET,
+        LINE_WIDTH,
+        MIN_SAMPLE_SHADING,
+        SAMPLE_MASK,
+        DEPTH_MASK,
+        DEPTH_FUNC,
+        DEPTH_BOUNDS,
+        STENCIL_OP,
+        STENCIL_FUNC,
+        STENCIL_MASK,
+        LOGIC_OP,
+        BLEND_EQUATION,
+        BLEND_FUNC,
+        COLOR_MASK,
+        BLEND_COLOR,
+        COUNT
+    };
+    static constexpr uint32_t maxShadowedStateIndex = 8;
+    struct AppliedState {
+        std::array<uint64_t, 4> values;
+        bool valid;
+    };
+    static uint64_t FloatBits(float value);
+    void SetCapability(Capability capability, bool enable);
+    void SetCapabilityIndexed(GLenum capability, GLuint index, bool enable);
+    bool StateChanged(State state, GLuint index, uint64_t value0, uint64_t value1 = 0, uint64_t value2 = 0, uint64_t value3 = 0);
+    void ResetStateTracking();
+
     virtual const std::vector<int64_t> GetSupportedColorSwapchainFormats() override;
     virtual const std::vector<int64_t> GetSupportedDepthSwapchainFormats() override;
 
 private:
     ksGpuWindow window{};
 
+    // When headless, the context comes from EGL instead of a ksGpuWindow and no display server is required.
+    bool headless = false;
+    static bool IsHeadlessRequested();
+    bool CreateHeadlessContext();
+    void DestroyHeadlessContext();
+#if defined(XR_TUTORIAL_USE_OPENGL_EGL)
+    EGLHeadlessContext eglHeadlessContext{};
+    XrGraphicsBindingEGLMNDX eglGraphicsBinding{};
+#endif
+
+    GLint majorVersion = 0;
+    GLint minorVersion = 0;
+    bool directStateAccess = false;
+    bool multiDrawIndirect = false;
+
     PFN_xrGetOpenGLGraphicsRequirementsKHR xrGetOpenGLGraphicsRequirementsKHR = nullptr;
 #if defined(XR_USE_PLATFORM_WIN32)
     XrGraphicsBindingOpenGLWin32KHR graphicsBinding{};
@@ -93,14 +199,143 @@ private:
 
     std::unordered_map<XrSwapchain, std::pair<SwapchainType, std::vector<XrSwapchainImageOpenGLKHR>>> swapchainImagesMap{};
 
-    std::unordered_map<GLuint, BufferCreateInfo> buffers{};
-    std::unordered_map<GLuint, ImageCreateInfo> images{};
+    // Number of frames that the CPU can write ahead of the GPU. Streamed data, and DYNAMIC and STREAM buffers, are kept once per frame.
+    static constexpr uint32_t streamingRegionCount = 3;
+
+    // Buffers and pipelines are looked up on every draw, so they're kept in SlotMaps.
+    // With buffer storage, DYNAMIC and STREAM buffers are persistently mapped and hold one copy per streaming region. The first write
+    // in a frame moves the buffer to a region that the GPU is done with, so the buffer is bound after it's written.
+    struct BufferResource {
+        GLuint buffer = 0;
+        BufferCreateInfo bufferCI;
+        uint8_t* mappedData = nullptr;
+        size_t regionSize = 0;
+        uint32_t regionIndex = 0;                                   // Region that holds the current contents.
+        uint64_t regionFrameIndex = 0;                              // Frame in which the contents were last moved to regionIndex.
+        std::array<uint64_t, streamingRegionCount> regionUseFrameIndices = {};  // Frame in which each region was last bound.
+    };
+    SlotMap<BufferResource, BufferTag> buffers;
+    // Uniform buffer bindings stay set across frames, so their buffers are used by each frame until they're replaced.
+    std::vector<BufferHandle> setUniformBuffers;
+    // GL texture names are small and dense, so image descriptors look up their targets by name.
+    std::vector<GLenum> imageTargets;
     std::unordered_map<GLuint, ImageViewCreateInfo> imageViews{};
 
     GLuint setFramebuffer = 0;
-    std::unordered_map<GLuint, PipelineCreateInfo> pipelines{};
-    GLuint setPipeline = 0;
+    std::map<std::vector<GLuint>, GLuint> framebufferCache;
+    struct PipelineResource {
+        GLuint program = 0;
+        PipelineCreateInfo pipelineCI;
+    };
+    SlotMap<PipelineResource, PipelineTag> pipelines;
+    PipelineHandle setPipeline;
     GLuint vertexArray = 0;
-    GLuint setIndexBuffer = 0;
+    GLuint emptyVertexArray = 0;
+    std::map<std::pair<std::vector<uint64_t>, std::vector<GLuint>>, GLuint> vertexArrayCache;
+    BufferHandle setIndexBuffer;
+    size_t setIndexBufferOffset = 0;
+
+    uint8_t appliedCapabilities[(size_t)Capability::COUNT] = {};  // 0 if unknown, otherwise 1 + enabled.
+    AppliedState appliedStates[(size_t)State::COUNT][maxShadowedStateIndex] = {};
+    uint64_t skippedStateChangeCount = 0;
+
+    // Push constants, indirect draw commands and uniform data written by AllocateUniformBufferData() go into one region of this buffer
+    // per frame. Outside of BeginFrame()/EndFrame(), each BeginRendering()/EndRendering() pair is a frame. Regions are reused only
+    // after the GPU has signalled their fence.
+    static constexpr size_t streamingRegionSize = 4 * 1024 * 1024;
+    GLuint streamingBuffer = 0;
+    BufferHandle streamingBufferHandle;  // Returned by AllocateUniformBufferData().
+    uint8_t* streamingBufferMappedData = nullptr;
+    std::vector<GLsync> streamingFences;
+    uint32_t streamingRegionIndex = 0;
+    size_t streamingOffset = 0;
+    // Counts the frames, starting at streamingRegionCount so that regions that were never used are free. The current frame's region
+    // is streamingRegionIndex, and the frames up to streamingFrameIndex - streamingRegionCount are complete.
+    uint64_t streamingFrameIndex = streamingRegionCount;
+    bool bufferStorage = false;
+    bool inFrame = false;
+    size_t uniformBufferOffsetAlignment = 256;
+    // Allocations are aligned for binding as a uniform buffer, which also satisfies the 4 byte alignment of indirect draw commands.
+    size_t streamingOffsetAlignment = 256;
+
+    // Push constants are emulated with a uniform block at pushConstantsBindingIndex. A copy is streamed before each draw that follows a
+    // change, or written to pushConstantsBuffer when the streaming region is full.
+    uint8_t pushConstantsData[maxPushConstantsSize] = {};
+    bool pushConstantsDirty = false;
+    GLuint pushConstantsBuffer = 0;
+
+    struct ShaderSource {
+        GLenum type;
+        std::string source;
+        bool compiled;
+    };
+    std::unordered_map<GLuint, ShaderSource> shaderSources{};
+
+    // Linked programs from glGetProgramBinary(), keyed by the hash of their shader sources.
+    struct ProgramBinary {
+        GLenum format;
+        std::vector<char> data;
+    };
+    std::unordered_map<uint64_t, ProgramBinary> programBinaries{};
+    std::string programBinaryCacheFilepath = "GraphicsAPI_OpenGL_ProgramBinaryCache.bin";
+    std::string driverString;
+    bool programBinaryCacheEnabled = false;
+    bool programBinaryCacheModified = false;
+
+    // Entry points that gfxwrapper doesn't load. They're resolved once by LoadFunctions(), when the context is created.
+    PFNGLGENSAMPLERSPROC glGenSamplers = nullptr;                                                                  // 3.2+
+    PFNGLSAMPLERPARAMETERIPROC glSamplerParameteri = nullptr;                                                      // 3.2+
+    PFNGLSAMPLERPARAMETERFPROC glSamplerParameterf = nullptr;                                                      // 3.2+
+    PFNGLSAMPLERPARAMETERFVPROC glSamplerParameterfv = nullptr;                                                    // 3.2+
+    PFNGLDELETESAMPLERSPROC glDeleteSamplers = nullptr;                                                            // 3.2+
+    PFNGLVALIDATEPROGRAMPROC glValidateProgram = nullptr;                                                          // 2.0+
+    PFNGLDETACHSHADERPROC glDetachShader = nullptr;                                                                // 2.0+
+    PFNGLVIEWPORTINDEXEDFPROC glViewportIndexedf = nullptr;                                                        // 4.1+
+    PFNGLDEPTHRANGEINDEXEDPROC glDepthRangeIndexed = nullptr;                                                      // 4.1+
+    PFNGLSCISSORINDEXEDPROC glScissorIndexed = nullptr;                                                            // 4.1+
+    PFNGLMINSAMPLESHADINGPROC glMinSampleShading = nullptr;                                                        // 4.0+
+    PFNGLSAMPLEMASKIPROC glSampleMaski = nullptr;                                                                  // 3.2+
+    PFNGLDEPTHBOUNDSEXTPROC glDepthBoundsEXT = nullptr;                                                            // EXT
+    PFNGLSTENCILOPSEPARATEPROC glStencilOpSeparate = nullptr;                                                      // 2.0+
+    PFNGLSTENCILFUNCSEPARATEPROC glStencilFuncSeparate = nullptr;                                                  // 2.0+
+    PFNGLSTENCILMASKSEPARATEPROC glStencilMaskSeparate = nullptr;                                                  // 2.0+
+    PFNGLENABLEIPROC glEnablei = nullptr;                                                                          // 3.0+
+    PFNGLDISABLEIPROC glDisablei = nullptr;                                                                        // 3.0+
+    PFNGLBLENDEQUATIONSEPARATEIPROC glBlendEquationSeparatei = nullptr;                                            // 4.0+
+    PFNGLBLENDFUNCSEPARATEIPROC glBlendFuncSeparatei = nullptr;                                                    // 4.0+
+    PFNGLCOLORMASKIPROC glColorMaski = nullptr;                                                                    // 3.0+
+    PFNGLBINDBUFFERRANGEPROC glBindBufferRange = nullptr;                                                          // 3.0+
+    PFNGLBINDSAMPLERPROC glBindSampler = nullptr;                                                                  // 3.0+
+    PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC glDrawElementsInstancedBaseVertexBaseInstance = nullptr;  // 4.2+
+    PFNGLDRAWARRAYSINSTANCEDBASEINSTANCEPROC glDrawArraysInstancedBaseInstance = nullptr;                          // 4.2+
+    PFNGLGETSTRINGIPROC glGetStringi = nullptr;                                                                    // 3.0+
+    PFNGLVERTEXATTRIBDIVISORPROC glVertexAttribDivisor = nullptr;                                                  // 3.3+
+    PFNGLBUFFERSTORAGEPROC glBufferStorage = nullptr;                                                              // 4.4+ or ARB_buffer_storage
+    PFNGLPROGRAMPARAMETERIPROC glProgramParameteri = nullptr;                                                      // 4.1+ or ARB_get_program_binary
+    PFNGLGETPROGRAMBINARYPROC glGetProgramBinary = nullptr;                                                        // 4.1+ or ARB_get_program_binary
+    PFNGLPROGRAMBINARYPROC glProgramBinary = nullptr;                                                              // 4.1+ or ARB_get_program_binary
+    PFNGLMULTIDRAWELEMENTSINDIRECTPROC glMultiDrawElementsIndirect = nullptr;                                      // 4.3+ or ARB_multi_draw_indirect
+    PFNGLCREATEBUFFERSPROC glCreateBuffers = nullptr;                                                              // 4.5+ or ARB_direct_state_access
+    PFNGLNAMEDBUFFERDATAPROC glNamedBufferData = nullptr;                                                          // 4.5+ or ARB_direct_state_access
+    PFNGLNAMEDBUFFERSUBDATAPROC glNamedBufferSubData = nullptr;                                                    // 4.5+ or ARB_direct_state_access
+    PFNGLNAMEDBUFFERSTORAGEPROC glNamedBufferStorage = nullptr;                                                    // 4.5+ or ARB_direct_state_access
+    PFNGLMAPNAMEDBUFFERRANGEPROC glMapNamedBufferRange = nullptr;                                                  // 4.5+ or ARB_direct_state_access
+    PFNGLUNMAPNAMEDBUFFERPROC glUnmapNamedBuffer = nullptr;                                                        // 4.5+ or ARB_direct_state_access
+    PFNGLCREATEFRAMEBUFFERSPROC glCreateFramebuffers = nullptr;                                                    // 4.5+ or ARB_direct_state_access
+    PFNGLNAMEDFRAMEBUFFERTEXTUREPROC glNamedFramebufferTexture = nullptr;                                          // 4.5+ or ARB_direct_state_access
+    PFNGLCHECKNAMEDFRAMEBUFFERSTATUSPROC glCheckNamedFramebufferStatus = nullptr;                                  // 4.5+ or ARB_direct_state_access
+    PFNGLCLEARNAMEDFRAMEBUFFERFVPROC glClearNamedFramebufferfv = nullptr;                                          // 4.5+ or ARB_direct_state_access
+    PFNGLCREATEVERTEXARRAYSPROC glCreateVertexArrays = nullptr;                                                    // 4.5+ or ARB_direct_state_access
+    PFNGLENABLEVERTEXARRAYATTRIBPROC glEnableVertexArrayAttrib = nullptr;                                          // 4.5+ or ARB_direct_state_access
+    PFNGLVERTEXARRAYATTRIBFORMATPROC glVertexArrayAttribFormat = nullptr;                                          // 4.5+ or ARB_direct_state_access
+    PFNGLVERTEXARRAYATTRIBBINDINGPROC glVertexArrayAttribBinding = nullptr;                                        // 4.5+ or ARB_direct_state_access
+    PFNGLVERTEXARRAYVERTEXBUFFERPROC glVertexArrayVertexBuffer = nullptr;                                          // 4.5+ or ARB_direct_state_access
+    PFNGLVERTEXARRAYELEMENTBUFFERPROC glVertexArrayElementBuffer = nullptr;                                        // 4.5+ or ARB_direct_state_access
+    PFNGLVERTEXARRAYBINDINGDIVISORPROC glVertexArrayBindingDivisor = nullptr;                                      // 4.5+ or ARB_direct_state_access
+};
+
+template <>
+struct GraphicsAPI_Backend<OPENGL> {
+    typedef GraphicsAPI_OpenGL Type;
 };
 #endif
\ No newline at end of file
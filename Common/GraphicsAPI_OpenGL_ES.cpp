@@ -12,9 +12,7 @@
 PROC GetExtension(const char *functionName) { return wglGetProcAddress(functionName); }
 #elif defined(OS_APPLE)
 void (*GetExtension(const char *functionName))() { return NULL; }
-#elif defined(OS_LINUX_XCB) || defined(OS_LINUX_XLIB) || defined(OS_LINUX_XCB_GLX)
-void (*GetExtension(const char *functionName))() { return glXGetProcAddress((const GLubyte *)functionName); }
-#elif defined(OS_ANDROID) || defined(OS_LINUX_WAYLAND)
+#elif defined(OS_ANDROID) || defined(OS_LINUX_XCB) || defined(OS_LINUX_XLIB) || defined(OS_LINUX_XCB_GLX) || defined(OS_LINUX_WAYLAND)
 void (*GetExtension(const char *functionName))() { return eglGetProcAddress(functionName); }
 #endif
 
@@ -355,6 +353,27 @@ void GLDebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLs
         DEBUG_BREAK;
 }
 
+#if !defined(__ANDROID__)
+bool GraphicsAPI_OpenGL_ES::CreateEGLContext() {
+    // Match the OpenGL ES 3.2 context that gfxwrapper creates on Android.
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 2,
+        EGL_NONE};
+    if (!eglHeadlessContext.Create(EGL_OPENGL_ES_API, EGL_OPENGL_ES3_BIT, contextAttribs)) {
+        return false;
+    }
+
+    // gfxwrapper's function pointers are normally loaded by ksGpuWindow_Create.
+    GlInitExtensions();
+    return true;
+}
+
+void GraphicsAPI_OpenGL_ES::DestroyEGLContext() {
+    eglHeadlessContext.Destroy();
+}
+#endif
+
 GraphicsAPI_OpenGL_ES::GraphicsAPI_OpenGL_ES() {
     // https://github.com/KhronosGroup/OpenXR-SDK-Source/blob/f122f9f1fc729e2dc82e12c3ce73efa875182854/src/tests/hello_xr/graphicsplugin_opengles.cpp#L101-L119
     // Initialize the gl extensions. Note we have to open a window.
@@ -363,9 +382,15 @@ GraphicsAPI_OpenGL_ES::GraphicsAPI_OpenGL_ES() {
     ksGpuSurfaceColorFormat colorFormat{KS_GPU_SURFACE_COLOR_FORMAT_B8G8R8A8};
     ksGpuSurfaceDepthFormat depthFormat{KS_GPU_SURFACE_DEPTH_FORMAT_D24};
     ksGpuSampleCount sampleCount{KS_GPU_SAMPLE_COUNT_1};
+#if defined(__ANDROID__)
     if (!ksGpuWindow_Create(&window, &driverInstance, &queueInfo, 0, colorFormat, depthFormat, sampleCount, 640, 480, false)) {
         std::cout << "ERROR: OPENGL ES: Failed to create Context." << std::endl;
     }
+#else
+    if (!CreateEGLContext()) {
+        std::cout << "ERROR: OPENGL ES: Failed to create Context." << std::endl;
+    }
+#endif
 
     GLint glMajorVersion = 0;
     GLint glMinorVersion = 0;
@@ -392,9 +417,15 @@ GraphicsAPI_OpenGL_ES::GraphicsAPI_OpenGL_ES(XrInstance m_xrInstance, XrSystemId
     ksGpuSurfaceColorFormat colorFormat{KS_GPU_SURFACE_COLOR_FORMAT_B8G8R8A8};
     ksGpuSurfaceDepthFormat depthFormat{KS_GPU_SURFACE_DEPTH_FORMAT_D24};
     ksGpuSampleCount sampleCount{KS_GPU_SAMPLE_COUNT_1};
+#if defined(__ANDROID__)
     if (!ksGpuWindow_Create(&window, &driverInstance, &queueInfo, 0, colorFormat, depthFormat, sampleCount, 640, 480, false)) {
         std::cout << "ERROR: OPENGL ES: Failed to create Context." << std::endl;
     }
+#else
+    if (!CreateEGLContext()) {
+        std::cout << "ERROR: OPENGL ES: Failed to create Context." << std::endl;
+    }
+#endif
 
     GLint glMajorVersion = 0;
     GLint glMinorVersion = 0;
@@ -416,7 +447,14 @@ GraphicsAPI_OpenGL_ES::GraphicsAPI_OpenGL_ES(XrInstance m_xrInstance, XrSystemId
 }
 
 GraphicsAPI_OpenGL_ES::~GraphicsAPI_OpenGL_ES() {
+    if (pushConstantsBuffer) {
+        glDeleteBuffers(1, &pushConstantsBuffer);
+    }
+#if defined(__ANDROID__)
     ksGpuWindow_Destroy(&window);
+#else
+    DestroyEGLContext();
+#endif
 }
 // XR_DOCS_TAG_END_GraphicsAPI_OpenGL_ES
 
@@ -428,10 +466,19 @@ void GraphicsAPI_OpenGL_ES::PresentDesktopSwapchainImage(void *swapchain, uint32
 
 // XR_DOCS_TAG_BEGIN_GraphicsAPI_OpenGL_ES_GetGraphicsBinding
 void *GraphicsAPI_OpenGL_ES::GetGraphicsBinding() {
+#if defined(__ANDROID__)
     graphicsBinding = {XR_TYPE_GRAPHICS_BINDING_OPENGL_ES_ANDROID_KHR};
     graphicsBinding.display = window.display;
     graphicsBinding.config = window.context.config;
     graphicsBinding.context = window.context.context;
+#else
+    // Desktop runtimes accept an EGL context through XR_MNDX_egl_enable.
+    graphicsBinding = {XR_TYPE_GRAPHICS_BINDING_EGL_MNDX};
+    graphicsBinding.getProcAddress = reinterpret_cast<PFN_xrEglGetProcAddressMNDX>(eglGetProcAddress);
+    graphicsBinding.display = eglHeadlessContext.display;
+    graphicsBinding.config = eglHeadlessContext.config;
+    graphicsBinding.context = eglHeadlessContext.context;
+#endif
     return &graphicsBinding;
 }
 // XR_DOCS_TAG_END_GraphicsAPI_OpenGL_ES_GetGraphicsBinding
@@ -476,12 +523,15 @@ void *GraphicsAPI_OpenGL_ES::CreateImage(const ImageCreateInfo &imageCI) {
 
     glBindTexture(target, 0);
 
-    images[texture] = imageCI;
+    if (texture >= imageTargets.size()) {
+        imageTargets.resize(texture + 1, 0);
+    }
+    imageTargets[texture] = target;
     return (void *)(uint64_t)texture;
 }
 void GraphicsAPI_OpenGL_ES::DestroyImage(void *&image) {
     GLuint texture = (GLuint)(uint64_t)image;
-    images.erase(texture);
+    imageTargets[texture] = 0;
     glDeleteTextures(1, &texture);
     image = nullptr;
 }
@@ -557,7 +607,7 @@ void GraphicsAPI_OpenGL_ES::DestroySampler(void *&sampler) {
     sampler = nullptr;
 }
 
-void *GraphicsAPI_OpenGL_ES::CreateBuffer(const BufferCreateInfo &bufferCI) {
+GraphicsAPI::BufferHandle GraphicsAPI_OpenGL_ES::CreateBuffer(const BufferCreateInfo &bufferCI) {
     GLuint buffer = 0;
     glGenBuffers(1, &buffer);
 
@@ -573,19 +623,25 @@ void *GraphicsAPI_OpenGL_ES::CreateBuffer(const BufferCreateInfo &bufferCI) {
         std::cout << "ERROR: OPENGL: Unknown Buffer Type." << std::endl;
     }
 
+    GLenum usage = GL_DYNAMIC_DRAW;
+    if (bufferCI.usage == BufferCreateInfo::Usage::STATIC) {
+        usage = GL_STATIC_DRAW;
+    } else if (bufferCI.usage == BufferCreateInfo::Usage::STREAM) {
+        usage = GL_STREAM_DRAW;
+    }
+
     glBindBuffer(target, buffer);
-    glBufferData(target, (GLsizeiptr)bufferCI.size, bufferCI.data, GL_STATIC_DRAW);
+    glBufferData(target, (GLsizeiptr)bufferCI.size, bufferCI.data, usage);
     glBindBuffer(target, 0);
 
-    buffers[buffer] = bufferCI;
-    return (void *)(uint64_t)buffer;
+    return buffers.Insert({buffer, bufferCI});
 }
 
-void GraphicsAPI_OpenGL_ES::DestroyBuffer(void *&buffer) {
-    GLuint glBuffer = (GLuint)(uint64_t)buffer;
-    buffers.erase(glBuffer);
+void GraphicsAPI_OpenGL_ES::DestroyBuffer(BufferHandle &buffer) {
+    GLuint glBuffer = buffers[buffer].buffer;
+    buffers.Erase(buffer);
     glDeleteBuffers(1, &glBuffer);
-    buffer = nullptr;
+    buffer = BufferHandle();
 }
 
 void *GraphicsAPI_OpenGL_ES::CreateShader(const ShaderCreateInfo &shaderCI) {
@@ -646,7 +702,7 @@ void GraphicsAPI_OpenGL_ES::DestroyShader(void *&shader) {
     shader = nullptr;
 }
 
-void *GraphicsAPI_OpenGL_ES::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
+GraphicsAPI::PipelineHandle GraphicsAPI_OpenGL_ES::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
     GLuint program = glCreateProgram();
 
     for (const void *const &shader : pipelineCI.shaders)
@@ -670,16 +726,14 @@ void *GraphicsAPI_OpenGL_ES::CreatePipeline(const PipelineCreateInfo &pipelineCI
     for (const void *const &shader : pipelineCI.shaders)
         glDetachShader(program, (GLuint)(uint64_t)shader);
 
-    pipelines[program] = pipelineCI;
-
-    return (void *)(uint64_t)program;
+    return pipelines.Insert({program, pipelineCI});
 }
 
-void GraphicsAPI_OpenGL_ES::DestroyPipeline(void *&pipeline) {
-    GLint program = (GLuint)(uint64_t)pipeline;
-    pipelines.erase(program);
+void GraphicsAPI_OpenGL_ES::DestroyPipeline(PipelineHandle &pipeline) {
+    GLuint program = pipelines[pipeline].program;
+    pipelines.Erase(pipeline);
     glDeleteProgram(program);
-    pipeline = nullptr;
+    pipeline = PipelineHandle();
 }
 
 void GraphicsAPI_OpenGL_ES::BeginRendering() {
@@ -714,9 +768,10 @@ void GraphicsAPI_OpenGL_ES::ClearDepth(void *imageView, float d) {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void GraphicsAPI_OpenGL_ES::SetBufferData(void *buffer, size_t offset, size_t size, void *data) {
-    GLuint glBuffer = (GLuint)(uint64_t)buffer;
-    const BufferCreateInfo &bufferCI = buffers[glBuffer];
+void GraphicsAPI_OpenGL_ES::SetBufferData(BufferHandle buffer, size_t offset, size_t size, void *data) {
+    const BufferResource &bufferResource = buffers[buffer];
+    GLuint glBuffer = bufferResource.buffer;
+    const BufferCreateInfo &bufferCI = bufferResource.bufferCI;
 
     GLenum target = 0;
     if (bufferCI.type == BufferCreateInfo::Type::VERTEX) {
@@ -737,7 +792,7 @@ void GraphicsAPI_OpenGL_ES::SetBufferData(void *buffer, size_t offset, size_t si
     }
 }
 
-void GraphicsAPI_OpenGL_ES::SetRenderAttachments(void **colorViews, size_t colorViewCount, void *depthStencilView, uint32_t width, uint32_t height, void *pipeline) {
+void GraphicsAPI_OpenGL_ES::SetRenderAttachments(void **colorViews, size_t colorViewCount, void *depthStencilView, uint32_t width, uint32_t height, PipelineHandle pipeline) {
     // Reset Framebuffer
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glDeleteFramebuffers(1, &setFramebuffer);
@@ -795,12 +850,12 @@ void GraphicsAPI_OpenGL_ES::SetScissors(Rect2D *scissors, size_t count) {
     glScissor((GLint)scissor.offset.x, (GLint)scissor.offset.y, (GLsizei)scissor.extent.width, (GLsizei)scissor.extent.height);
 }
 
-void GraphicsAPI_OpenGL_ES::SetPipeline(void *pipeline) {
-    GLuint program = (GLuint)(uint64_t)pipeline;
-    glUseProgram(program);
-    setPipeline = program;
+void GraphicsAPI_OpenGL_ES::SetPipeline(PipelineHandle pipeline) {
+    const PipelineResource &pipelineResource = pipelines[pipeline];
+    glUseProgram(pipelineResource.program);
+    setPipeline = pipeline;
 
-    const PipelineCreateInfo &pipelineCI = pipelines[program];
+    const PipelineCreateInfo &pipelineCI = pipelineResource.pipelineCI;
 
     // InputAssemblyState
     const InputAssemblyState &IAS = pipelineCI.inputAssemblyState;
@@ -988,10 +1043,11 @@ void GraphicsAPI_OpenGL_ES::SetDescriptor(const DescriptorInfo &descriptorInfo)
     GLuint glResource = (GLuint)(uint64_t)descriptorInfo.resource;
     const GLuint &bindingIndex = descriptorInfo.bindingIndex;
     if (descriptorInfo.type == DescriptorInfo::Type::BUFFER) {
+        glResource = buffers[BufferHandle::FromPointer(descriptorInfo.resource)].buffer;
         glBindBufferRange(GL_UNIFORM_BUFFER, bindingIndex, glResource, (GLintptr)descriptorInfo.bufferOffset, (GLsizeiptr)descriptorInfo.bufferSize);
     } else if (descriptorInfo.type == DescriptorInfo::Type::IMAGE) {
         glActiveTexture(GL_TEXTURE0 + bindingIndex);
-        glBindTexture(GetGLTextureTarget(images[glResource]), glResource);
+        glBindTexture(glResource < imageTargets.size() && imageTargets[glResource] ? imageTargets[glResource] : GL_TEXTURE_2D, glResource);
     } else if (descriptorInfo.type == DescriptorInfo::Type::SAMPLER) {
         glBindSampler(bindingIndex, glResource);
     } else {
@@ -1002,15 +1058,41 @@ void GraphicsAPI_OpenGL_ES::SetDescriptor(const DescriptorInfo &descriptorInfo)
 void GraphicsAPI_OpenGL_ES::UpdateDescriptors() {
 }
 
-void GraphicsAPI_OpenGL_ES::SetVertexBuffers(void **vertexBuffers, size_t count) {
-    const VertexInputState &vertexInputState = pipelines[setPipeline].vertexInputState;
+void GraphicsAPI_OpenGL_ES::SetPushConstants(DescriptorInfo::Stage stage, uint32_t offset, uint32_t size, const void *data) {
+    if (offset + size > maxPushConstantsSize) {
+        std::cout << "ERROR: OPENGL_ES: Push constants exceed " << maxPushConstantsSize << " bytes." << std::endl;
+        DEBUG_BREAK;
+        return;
+    }
+    memcpy(pushConstantsData + offset, data, size);
+    pushConstantsDirty = true;
+}
+
+void GraphicsAPI_OpenGL_ES::FlushPushConstants() {
+    if (!pushConstantsDirty) {
+        return;
+    }
+    pushConstantsDirty = false;
+
+    if (!pushConstantsBuffer) {
+        glGenBuffers(1, &pushConstantsBuffer);
+    }
+    // Orphaning the small buffer lets the driver hand out new storage, rather than waiting for the previous draws that read it.
+    glBindBuffer(GL_UNIFORM_BUFFER, pushConstantsBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)maxPushConstantsSize, pushConstantsData, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, pushConstantsBindingIndex, pushConstantsBuffer);
+}
+
+void GraphicsAPI_OpenGL_ES::SetVertexBuffers(BufferHandle *vertexBuffers, size_t count) {
+    const VertexInputState &vertexInputState = pipelines[setPipeline].pipelineCI.vertexInputState;
     for (size_t i = 0; i < count; i++) {
-        GLuint glVertexBufferID = (GLuint)(uint64_t)vertexBuffers[i];
-        if (buffers[glVertexBufferID].type != BufferCreateInfo::Type::VERTEX) {
+        const BufferResource &bufferResource = buffers[vertexBuffers[i]];
+        if (bufferResource.bufferCI.type != BufferCreateInfo::Type::VERTEX) {
             std::cout << "ERROR: OpenGL: Provided buffer is not type: VERTEX." << std::endl;
         }
 
-        glBindBuffer(GL_ARRAY_BUFFER, (GLuint)(uint64_t)vertexBuffers[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, bufferResource.buffer);
 
         // https://i.redd.it/fyxp5ah06a661.png
         for (const VertexInputBinding &vertexBinding : vertexInputState.bindings) {
@@ -1025,6 +1107,7 @@ void GraphicsAPI_OpenGL_ES::SetVertexBuffers(void **vertexBuffers, size_t count)
                         const void *offset = (const void *)vertexAttribute.offset;
                         glEnableVertexAttribArray(attribIndex);
                         glVertexAttribPointer(attribIndex, size, type, false, stride, offset);
+                        glVertexAttribDivisor(attribIndex, vertexBinding.inputRate == VertexInputRate::INSTANCE ? 1 : 0);
                     }
                 }
             }
@@ -1032,22 +1115,24 @@ void GraphicsAPI_OpenGL_ES::SetVertexBuffers(void **vertexBuffers, size_t count)
     }
 }
 
-void GraphicsAPI_OpenGL_ES::SetIndexBuffer(void *indexBuffer) {
-    GLuint glIndexBufferID = (GLuint)(uint64_t)indexBuffer;
-    if (buffers[glIndexBufferID].type != BufferCreateInfo::Type::INDEX) {
+void GraphicsAPI_OpenGL_ES::SetIndexBuffer(BufferHandle indexBuffer) {
+    const BufferResource &bufferResource = buffers[indexBuffer];
+    if (bufferResource.bufferCI.type != BufferCreateInfo::Type::INDEX) {
         std::cout << "ERROR: OpenGL: Provided buffer is not type: INDEX." << std::endl;
     }
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, glIndexBufferID);
-    setIndexBuffer = glIndexBufferID;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferResource.buffer);
+    setIndexBuffer = indexBuffer;
 }
 
 void GraphicsAPI_OpenGL_ES::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) {
-    GLenum indexType = buffers[setIndexBuffer].stride == 4 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
-    glDrawElementsInstanced(ToGLTopology(pipelines[setPipeline].inputAssemblyState.topology),indexCount, indexType, nullptr,instanceCount);
+    FlushPushConstants();
+    GLenum indexType = buffers[setIndexBuffer].bufferCI.stride == 4 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+    glDrawElementsInstanced(ToGLTopology(pipelines[setPipeline].pipelineCI.inputAssemblyState.topology),indexCount, indexType, nullptr,instanceCount);
 }
 
 void GraphicsAPI_OpenGL_ES::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) {
-    glDrawArraysInstanced(ToGLTopology(pipelines[setPipeline].inputAssemblyState.topology), firstVertex, vertexCount, instanceCount);
+    FlushPushConstants();
+    glDrawArraysInstanced(ToGLTopology(pipelines[setPipeline].pipelineCI.inputAssemblyState.topology), firstVertex, vertexCount, instanceCount);
 }
 
 // XR_DOCS_TAG_BEGIN_GraphicsAPI_OpenGL_ES_GetSupportedSwapchainFormats
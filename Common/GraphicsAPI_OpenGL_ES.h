@@ -8,7 +8,7 @@
 #include <GraphicsAPI.h>
 
 #if defined(XR_USE_GRAPHICS_API_OPENGL_ES)
-class GraphicsAPI_OpenGL_ES : public GraphicsAPI {
+class GraphicsAPI_OpenGL_ES final : public GraphicsAPI {
 public:
     GraphicsAPI_OpenGL_ES();
     GraphicsAPI_OpenGL_ES(XrInstance m_xrInstance, XrSystemId systemId);
@@ -44,32 +44,33 @@ public:
     virtual void* CreateSampler(const SamplerCreateInfo& samplerCI) override;
     virtual void DestroySampler(void*& sampler) override;
 
-    virtual void* CreateBuffer(const BufferCreateInfo& bufferCI) override;
-    virtual void DestroyBuffer(void*& buffer) override;
+    virtual BufferHandle CreateBuffer(const BufferCreateInfo& bufferCI) override;
+    virtual void DestroyBuffer(BufferHandle& buffer) override;
 
     virtual void* CreateShader(const ShaderCreateInfo& shaderCI) override;
     virtual void DestroyShader(void*& shader) override;
 
-    virtual void* CreatePipeline(const PipelineCreateInfo& pipelineCI) override;
-    virtual void DestroyPipeline(void*& pipeline) override;
+    virtual PipelineHandle CreatePipeline(const PipelineCreateInfo& pipelineCI) override;
+    virtual void DestroyPipeline(PipelineHandle& pipeline) override;
 
     virtual void BeginRendering() override;
     virtual void EndRendering() override;
 
-    virtual void SetBufferData(void* buffer, size_t offset, size_t size, void* data) override;
+    virtual void SetBufferData(BufferHandle buffer, size_t offset, size_t size, void* data) override;
 
     virtual void ClearColor(void* imageView, float r, float g, float b, float a) override;
     virtual void ClearDepth(void* imageView, float d) override;
 
-    virtual void SetRenderAttachments(void** colorViews, size_t colorViewCount, void* depthStencilView, uint32_t width, uint32_t height, void* pipeline) override;
+    virtual void SetRenderAttachments(void** colorViews, size_t colorViewCount, void* depthStencilView, uint32_t width, uint32_t height, PipelineHandle pipeline) override;
     virtual void SetViewports(Viewport* viewports, size_t count) override;
     virtual void SetScissors(Rect2D* scissors, size_t count) override;
 
-    virtual void SetPipeline(void* pipeline) override;
+    virtual void SetPipeline(PipelineHandle pipeline) override;
     virtual void SetDescriptor(const DescriptorInfo& descriptorInfo) override;
     virtual void UpdateDescriptors() override;
-    virtual void SetVertexBuffers(void** vertexBuffers, size_t count) override;
-    virtual void SetIndexBuffer(void* indexBuffer) override;
+    virtual void SetPushConstants(DescriptorInfo::Stage stage, uint32_t offset, uint32_t size, const void* data) override;
+    virtual void SetVertexBuffers(BufferHandle* vertexBuffers, size_t count) override;
+    virtual void SetIndexBuffer(BufferHandle indexBuffer) override;
     virtual void DrawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t firstInstance = 0) override;
     virtual void Draw(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0) override;
 
@@ -78,21 +79,55 @@ private:
     virtual const std::vector<int64_t> GetSupportedDepthSwapchainFormats() override;
 
 private:
+    void FlushPushConstants();
+
+#if defined(__ANDROID__)
     ksGpuWindow window{};
+#else
+    // Desktop Linux has no ksGpuWindow for OpenGL ES, so the context is created directly through EGL.
+    bool CreateEGLContext();
+    void DestroyEGLContext();
+
+    EGLHeadlessContext eglHeadlessContext{};
+#endif
 
     PFN_xrGetOpenGLESGraphicsRequirementsKHR xrGetOpenGLESGraphicsRequirementsKHR = nullptr;
+#if defined(__ANDROID__)
     XrGraphicsBindingOpenGLESAndroidKHR graphicsBinding{};
+#else
+    XrGraphicsBindingEGLMNDX graphicsBinding{};
+#endif
 
     std::unordered_map < XrSwapchain, std::pair<SwapchainType, std::vector<XrSwapchainImageOpenGLESKHR>>> swapchainImagesMap{};
 
-    std::unordered_map<GLuint, BufferCreateInfo> buffers{};
-    std::unordered_map<GLuint, ImageCreateInfo> images{};
+    // Buffers and pipelines are looked up on every draw, so they're kept in SlotMaps.
+    struct BufferResource {
+        GLuint buffer = 0;
+        BufferCreateInfo bufferCI;
+    };
+    SlotMap<BufferResource, BufferTag> buffers;
+    // GL texture names are small and dense, so image descriptors look up their targets by name.
+    std::vector<GLenum> imageTargets;
     std::unordered_map<GLuint, ImageViewCreateInfo> imageViews{};
 
     GLuint setFramebuffer = 0;
-    std::unordered_map<GLuint, PipelineCreateInfo> pipelines{};
-    GLuint setPipeline = 0;
+    struct PipelineResource {
+        GLuint program = 0;
+        PipelineCreateInfo pipelineCI;
+    };
+    SlotMap<PipelineResource, PipelineTag> pipelines;
+    PipelineHandle setPipeline;
     GLuint vertexArray = 0;
-    GLuint setIndexBuffer = 0;
+    BufferHandle setIndexBuffer;
+
+    // Push constants are emulated with a uniform block at pushConstantsBindingIndex. The buffer is orphaned before each draw that follows a change.
+    uint8_t pushConstantsData[maxPushConstantsSize] = {};
+    bool pushConstantsDirty = false;
+    GLuint pushConstantsBuffer = 0;
+};
+
+template <>
+struct GraphicsAPI_Backend<OPENGL_ES> {
+    typedef GraphicsAPI_OpenGL_ES Type;
 };
 #endif
\ No newline at end of file
@@ -90,7 +90,7 @@ VkDescriptorType ToVkDescrtiptorType(const GraphicsAPI::DescriptorInfo &descInfo
     return vkType;
 }
 
-GraphicsAPI_Vulkan::GraphicsAPI_Vulkan() {
+GraphicsAPI_Vulkan::GraphicsAPI_Vulkan(uint32_t framesInFlight) {
     // Instance
     VkApplicationInfo ai;
     ai.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -180,7 +180,7 @@ GraphicsAPI_Vulkan::GraphicsAPI_Vulkan() {
     deviceExtensionProperties.resize(deviceExtensionCount);
 
     VULKAN_CHECK(vkEnumerateDeviceExtensionProperties(physicalDevice, 0, &deviceExtensionCount, deviceExtensionProperties.data()), "Failed to enumerate DeviceExtensionProperties.");
-    const std::vector<std::string> &deviceExtensionNames = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    const std::vector<std::string> &deviceExtensionNames = {VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME};
     for (const std::string &requestExtension : deviceExtensionNames) {
         for (const VkExtensionProperties &extensionProperty : deviceExtensionProperties) {
             if (strcmp(requestExtension.c_str(), extensionProperty.extensionName))
@@ -194,6 +194,9 @@ GraphicsAPI_Vulkan::GraphicsAPI_Vulkan() {
     VkPhysicalDeviceFeatures features;
     vkGetPhysicalDeviceFeatures(physicalDevice, &features);
 
+    vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &physicalDeviceMemoryProperties);
+
     VkDeviceCreateInfo deviceCI;
     deviceCI.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCI.pNext = nullptr;
@@ -207,49 +210,21 @@ GraphicsAPI_Vulkan::GraphicsAPI_Vulkan() {
     deviceCI.pEnabledFeatures = &features;
     VULKAN_CHECK(vkCreateDevice(physicalDevice, &deviceCI, nullptr, &device), "Failed to create Device.");
 
-    VkCommandPoolCreateInfo cmdPoolCI;
-    cmdPoolCI.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    cmdPoolCI.pNext = nullptr;
-    cmdPoolCI.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    cmdPoolCI.queueFamilyIndex = queueFamilyIndex;
-    VULKAN_CHECK(vkCreateCommandPool(device, &cmdPoolCI, nullptr, &cmdPool), "Failed to create CommandPool.");
-
-    VkCommandBufferAllocateInfo allocateInfo;
-    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocateInfo.pNext = nullptr;
-    allocateInfo.commandPool = cmdPool;
-    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocateInfo.commandBufferCount = 1;
-    VULKAN_CHECK(vkAllocateCommandBuffers(device, &allocateInfo, &cmdBuffer), "Failed to allocate CommandBuffers.");
+    if (IsStringInVector(activeDeviceExtensions, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)) {
+        vkCreateDescriptorUpdateTemplateKHR = (PFN_vkCreateDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(device, "vkCreateDescriptorUpdateTemplateKHR");
+        vkDestroyDescriptorUpdateTemplateKHR = (PFN_vkDestroyDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(device, "vkDestroyDescriptorUpdateTemplateKHR");
+        vkUpdateDescriptorSetWithTemplateKHR = (PFN_vkUpdateDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(device, "vkUpdateDescriptorSetWithTemplateKHR");
+    }
 
     vkGetDeviceQueue(device, queueFamilyIndex, queueIndex, &queue);
 
-    VkFenceCreateInfo fenceCI{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
-    fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceCI.pNext = nullptr;
-    fenceCI.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    VULKAN_CHECK(vkCreateFence(device, &fenceCI, nullptr, &fence), "Failed to create Fence.")
-    
-    uint32_t maxSets = 1024;
-    std::vector<VkDescriptorPoolSize> poolSizes{
-        {VK_DESCRIPTOR_TYPE_SAMPLER, 16 * maxSets},
-        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 16 * maxSets},
-        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 16 * maxSets},
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 16 * maxSets},
-        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 16 * maxSets}};
-
-    VkDescriptorPoolCreateInfo descPoolCI;
-    descPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    descPoolCI.pNext = nullptr;
-    descPoolCI.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-    descPoolCI.maxSets = maxSets;
-    descPoolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    descPoolCI.pPoolSizes = poolSizes.data();
-    VULKAN_CHECK(vkCreateDescriptorPool(device, &descPoolCI, nullptr, &descriptorPool), "Failed to create DescriptorPool");
+    CreateFrameContexts(framesInFlight);
+    CreateUploadContext();
+    CreatePipelineCache();
 }
 
 // XR_DOCS_TAG_BEGIN_GraphicsAPI_Vulkan
-GraphicsAPI_Vulkan::GraphicsAPI_Vulkan(XrInstance m_xrInstance, XrSystemId systemId) {
+GraphicsAPI_Vulkan::GraphicsAPI_Vulkan(XrInstance m_xrInstance, XrSystemId systemId, uint32_t framesInFlight) {
     // Instance
     LoadPFN_XrFunctions(m_xrInstance);
 
@@ -345,7 +320,8 @@ GraphicsAPI_Vulkan::GraphicsAPI_Vulkan(XrInstance m_xrInstance, XrSystemId syste
     deviceExtensionProperties.resize(deviceExtensionCount);
 
     VULKAN_CHECK(vkEnumerateDeviceExtensionProperties(physicalDevice, 0, &deviceExtensionCount, deviceExtensionProperties.data()), "Failed to enumerate DeviceExtensionProperties.");
-    const std::vector<std::string> &openXrDeviceExtensionNames = GetDeviceExtensionsForOpenXR(m_xrInstance, systemId);
+    std::vector<std::string> openXrDeviceExtensionNames = GetDeviceExtensionsForOpenXR(m_xrInstance, systemId);
+    openXrDeviceExtensionNames.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
     for (const std::string &requestExtension : openXrDeviceExtensionNames) {
         for (const VkExtensionProperties &extensionProperty : deviceExtensionProperties) {
             if (strcmp(requestExtension.c_str(), extensionProperty.extensionName))
@@ -359,6 +335,9 @@ GraphicsAPI_Vulkan::GraphicsAPI_Vulkan(XrInstance m_xrInstance, XrSystemId syste
     VkPhysicalDeviceFeatures features;
     vkGetPhysicalDeviceFeatures(physicalDevice, &features);
 
+    vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &physicalDeviceMemoryProperties);
+
     VkDeviceCreateInfo deviceCI;
     deviceCI.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCI.pNext = nullptr;
@@ -372,29 +351,520 @@ GraphicsAPI_Vulkan::GraphicsAPI_Vulkan(XrInstance m_xrInstance, XrSystemId syste
     deviceCI.pEnabledFeatures = &features;
     VULKAN_CHECK(vkCreateDevice(physicalDevice, &deviceCI, nullptr, &device), "Failed to create Device.");
 
+    if (IsStringInVector(activeDeviceExtensions, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)) {
+        vkCreateDescriptorUpdateTemplateKHR = (PFN_vkCreateDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(device, "vkCreateDescriptorUpdateTemplateKHR");
+        vkDestroyDescriptorUpdateTemplateKHR = (PFN_vkDestroyDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(device, "vkDestroyDescriptorUpdateTemplateKHR");
+        vkUpdateDescriptorSetWithTemplateKHR = (PFN_vkUpdateDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(device, "vkUpdateDescriptorSetWithTemplateKHR");
+    }
+
+    vkGetDeviceQueue(device, queueFamilyIndex, queueIndex, &queue);
+
+    CreateFrameContexts(framesInFlight);
+    CreateUploadContext();
+    CreatePipelineCache();
+}
+
+GraphicsAPI_Vulkan::~GraphicsAPI_Vulkan() {
+    VULKAN_CHECK(vkDeviceWaitIdle(device), "Failed to wait for Device.");
+
+    for (const auto &framebuffer : framebufferCache) {
+        vkDestroyFramebuffer(device, framebuffer.second, nullptr);
+    }
+    framebufferCache.clear();
+
+    SavePipelineCache();
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
+
+    for (const auto &renderPassVariant : renderPassVariants) {
+        vkDestroyRenderPass(device, renderPassVariant.second, nullptr);
+    }
+    renderPassVariants.clear();
+
+    DestroyFrameContexts();
+    DestroyUploadContext();
+
+    for (MemoryBlock &memoryBlock : memoryBlocks) {
+        DestroyMemoryBlock(memoryBlock);
+    }
+    memoryBlocks.clear();
+
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(instance, nullptr);
+}
+// XR_DOCS_TAG_END_GraphicsAPI_Vulkan
+
+// Appends the bytes of a value to a key. Fields are appended one at a time, so that struct padding never ends up in a key.
+template <typename T>
+static void AppendKey(std::string &key, const T &value) {
+    key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+// Objects shared between pipelines are reference counted by their key. Returns true and adds a reference, if the object already exists.
+template <typename T>
+static bool AcquireSharedObject(std::unordered_map<std::string, std::pair<T, uint32_t>> &sharedObjects, const std::string &key, T &object) {
+    auto it = sharedObjects.find(key);
+    if (it == sharedObjects.end()) {
+        return false;
+    }
+    it->second.second++;
+    object = it->second.first;
+    return true;
+}
+
+// Returns true when the last reference was released, and the object should be destroyed.
+template <typename T>
+static bool ReleaseSharedObject(std::unordered_map<std::string, std::pair<T, uint32_t>> &sharedObjects, const std::string &key) {
+    auto it = sharedObjects.find(key);
+    if (it == sharedObjects.end() || --it->second.second > 0) {
+        return false;
+    }
+    sharedObjects.erase(it);
+    return true;
+}
+
+// Header of the pipeline cache file. Files written by another device or driver version are ignored, rather than handed to the driver.
+struct PipelineCacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t dataSize;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+static constexpr uint32_t pipelineCacheFileMagic = 0x4B43504F;  // "OPCK"
+static constexpr uint32_t pipelineCacheFileVersion = 1;
+
+void GraphicsAPI_Vulkan::CreatePipelineCache() {
+    // Seed the cache from disk, if the file was written by this device and driver.
+    std::vector<char> fileData = ReadBinaryFile(pipelineCacheFilepath);
+    const void *initialData = nullptr;
+    size_t initialDataSize = 0;
+    if (fileData.size() >= sizeof(PipelineCacheFileHeader)) {
+        PipelineCacheFileHeader header;
+        memcpy(&header, fileData.data(), sizeof(PipelineCacheFileHeader));
+        if (header.magic == pipelineCacheFileMagic && header.version == pipelineCacheFileVersion
+            && header.dataSize == fileData.size() - sizeof(PipelineCacheFileHeader)
+            && header.vendorID == physicalDeviceProperties.vendorID && header.deviceID == physicalDeviceProperties.deviceID
+            && header.driverVersion == physicalDeviceProperties.driverVersion
+            && memcmp(header.pipelineCacheUUID, physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0) {
+            initialData = fileData.data() + sizeof(PipelineCacheFileHeader);
+            initialDataSize = static_cast<size_t>(header.dataSize);
+        } else {
+            std::cout << "WARNING: VULKAN: Ignoring pipeline cache " << pipelineCacheFilepath << ". It was written by a different device or driver." << std::endl;
+        }
+    }
+
+    VkPipelineCacheCreateInfo pipelineCacheCI;
+    pipelineCacheCI.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheCI.pNext = nullptr;
+    pipelineCacheCI.flags = 0;
+    pipelineCacheCI.initialDataSize = initialDataSize;
+    pipelineCacheCI.pInitialData = initialData;
+    VULKAN_CHECK(vkCreatePipelineCache(device, &pipelineCacheCI, nullptr, &pipelineCache), "Failed to create PipelineCache.");
+}
+
+void GraphicsAPI_Vulkan::SavePipelineCache() {
+    size_t dataSize = 0;
+    VULKAN_CHECK(vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr), "Failed to get PipelineCache data size.");
+    std::vector<char> fileData(sizeof(PipelineCacheFileHeader) + dataSize);
+    VULKAN_CHECK(vkGetPipelineCacheData(device, pipelineCache, &dataSize, fileData.data() + sizeof(PipelineCacheFileHeader)), "Failed to get PipelineCache data.");
+
+    PipelineCacheFileHeader header;
+    memset(&header, 0, sizeof(PipelineCacheFileHeader));
+    header.magic = pipelineCacheFileMagic;
+    header.version = pipelineCacheFileVersion;
+    header.dataSize = static_cast<uint64_t>(dataSize);
+    header.vendorID = physicalDeviceProperties.vendorID;
+    header.deviceID = physicalDeviceProperties.deviceID;
+    header.driverVersion = physicalDeviceProperties.driverVersion;
+    memcpy(header.pipelineCacheUUID, physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+    memcpy(fileData.data(), &header, sizeof(PipelineCacheFileHeader));
+
+    std::ofstream stream(pipelineCacheFilepath, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+    if (!stream.is_open()) {
+        std::cout << "WARNING: VULKAN: Could not write pipeline cache " << pipelineCacheFilepath << "." << std::endl;
+        return;
+    }
+    stream.write(fileData.data(), static_cast<std::streamsize>(sizeof(PipelineCacheFileHeader) + dataSize));
+    stream.close();
+}
+
+void GraphicsAPI_Vulkan::CreateFrameContexts(uint32_t framesInFlight) {
+    frameContexts.resize(std::max(framesInFlight, 1u));
+    frameContextIndex = 0;
+
+    for (FrameContext &frameContext : frameContexts) {
+        VkCommandPoolCreateInfo cmdPoolCI;
+        cmdPoolCI.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        cmdPoolCI.pNext = nullptr;
+        cmdPoolCI.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        cmdPoolCI.queueFamilyIndex = queueFamilyIndex;
+        VULKAN_CHECK(vkCreateCommandPool(device, &cmdPoolCI, nullptr, &frameContext.cmdPool), "Failed to create CommandPool.");
+
+        VkCommandBufferAllocateInfo allocateInfo;
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.pNext = nullptr;
+        allocateInfo.commandPool = frameContext.cmdPool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        VULKAN_CHECK(vkAllocateCommandBuffers(device, &allocateInfo, &frameContext.cmdBuffer), "Failed to allocate CommandBuffers.");
+
+        VkFenceCreateInfo fenceCI{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceCI.pNext = nullptr;
+        fenceCI.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        VULKAN_CHECK(vkCreateFence(device, &fenceCI, nullptr, &frameContext.fence), "Failed to create Fence.")
+
+        frameContext.descriptorPools.push_back(CreateDescriptorPool());
+    }
+    cmdBuffer = frameContexts[frameContextIndex].cmdBuffer;
+}
+
+void GraphicsAPI_Vulkan::DestroyFrameContexts() {
+    for (FrameContext &frameContext : frameContexts) {
+        for (BufferHandle &buffer : frameContext.uniformBufferRing.buffers) {
+            DestroyBuffer(buffer);
+        }
+        frameContext.uniformBufferRing.buffers.clear();
+    }
+    // The device is idle, so everything that was deferred can be destroyed now.
+    for (FrameContext &frameContext : frameContexts) {
+        DestroyDeferredObjects(frameContext.deferredDestroys);
+
+        for (const VkDescriptorPool &descriptorPool : frameContext.descriptorPools) {
+            vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        }
+        frameContext.descriptorPools.clear();
+        frameContext.descriptorSetCache.clear();
+        vkDestroyFence(device, frameContext.fence, nullptr);
+        vkFreeCommandBuffers(device, frameContext.cmdPool, 1, &frameContext.cmdBuffer);
+        vkDestroyCommandPool(device, frameContext.cmdPool, nullptr);
+    }
+    frameContexts.clear();
+    cmdBuffer = VK_NULL_HANDLE;
+}
+
+GraphicsAPI_Vulkan::MemoryAllocation GraphicsAPI_Vulkan::AllocateMemory(const VkMemoryRequirements &memoryRequirements, VkMemoryPropertyFlags properties, MemoryStrategy strategy, bool image) {
+    MemoryAllocation allocation;
+    uint32_t memoryTypeIndex = 0;
+    if (!MemoryTypeFromProperties(physicalDeviceMemoryProperties, memoryRequirements.memoryTypeBits, properties, &memoryTypeIndex)) {
+        std::cout << "ERROR: VULKAN: Failed to find a suitable memory type." << std::endl;
+        DEBUG_BREAK;
+        return allocation;
+    }
+
+    // Sub-allocate from an existing block of the same kind, if one has enough space.
+    for (MemoryBlock &memoryBlock : memoryBlocks) {
+        if (memoryBlock.memoryTypeIndex == memoryTypeIndex && memoryBlock.strategy == strategy && memoryBlock.image == image && !memoryBlock.dedicated
+            && SubAllocateMemory(memoryBlock, memoryRequirements.size, memoryRequirements.alignment, allocation)) {
+            return allocation;
+        }
+    }
+
+    // Otherwise allocate a new block. Small heaps get smaller blocks, and large resources get a block of their own.
+    const VkMemoryHeap &memoryHeap = physicalDeviceMemoryProperties.memoryHeaps[physicalDeviceMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+    const VkDeviceSize blockSize = std::min(VkDeviceSize(memoryBlockSize), memoryHeap.size / 8);
+    MemoryBlock memoryBlock;
+    memoryBlock.dedicated = memoryRequirements.size > blockSize / 2;
+    memoryBlock.size = memoryBlock.dedicated ? memoryRequirements.size : blockSize;
+    memoryBlock.memoryTypeIndex = memoryTypeIndex;
+    memoryBlock.strategy = strategy;
+    memoryBlock.image = image;
+    memoryBlock.freeRanges[0] = memoryBlock.size;
+
+    VkMemoryAllocateInfo allocateInfo;
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.pNext = nullptr;
+    allocateInfo.allocationSize = memoryBlock.size;
+    allocateInfo.memoryTypeIndex = memoryTypeIndex;
+    VULKAN_CHECK(vkAllocateMemory(device, &allocateInfo, nullptr, &memoryBlock.memory), "Failed to allocate Memory.");
+
+    // HOST_VISIBLE blocks are mapped once for their lifetime, as a VkDeviceMemory can only be mapped once at a time.
+    if (BitwiseCheck(physicalDeviceMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags, (VkMemoryPropertyFlags)VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+        VULKAN_CHECK(vkMapMemory(device, memoryBlock.memory, 0, VK_WHOLE_SIZE, 0, &memoryBlock.mappedData), "Can not map Memory.");
+    }
+
+    memoryBlocks.push_back(memoryBlock);
+    SubAllocateMemory(memoryBlocks.back(), memoryRequirements.size, memoryRequirements.alignment, allocation);
+    return allocation;
+}
+
+bool GraphicsAPI_Vulkan::SubAllocateMemory(MemoryBlock &memoryBlock, VkDeviceSize size, VkDeviceSize alignment, MemoryAllocation &allocation) {
+    VkDeviceSize offset = 0;
+    if (memoryBlock.strategy == MemoryStrategy::LINEAR) {
+        offset = Align<VkDeviceSize>(memoryBlock.linearOffset, alignment);
+        if (offset + size > memoryBlock.size) {
+            return false;
+        }
+        memoryBlock.linearOffset = offset + size;
+    } else {
+        // First fit. The alignment padding in front of the allocation and the remainder after it stay free.
+        auto it = memoryBlock.freeRanges.begin();
+        for (; it != memoryBlock.freeRanges.end(); it++) {
+            offset = Align<VkDeviceSize>(it->first, alignment);
+            if (offset + size <= it->first + it->second) {
+                break;
+            }
+        }
+        if (it == memoryBlock.freeRanges.end()) {
+            return false;
+        }
+        const VkDeviceSize rangeOffset = it->first;
+        const VkDeviceSize rangeEnd = it->first + it->second;
+        memoryBlock.freeRanges.erase(it);
+        if (offset > rangeOffset) {
+            memoryBlock.freeRanges[rangeOffset] = offset - rangeOffset;
+        }
+        if (offset + size < rangeEnd) {
+            memoryBlock.freeRanges[offset + size] = rangeEnd - (offset + size);
+        }
+    }
+    memoryBlock.allocationCount++;
+    memoryBlock.usedSize += size;
+
+    allocation.memory = memoryBlock.memory;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.mappedData = memoryBlock.mappedData ? (uint8_t *)memoryBlock.mappedData + offset : nullptr;
+    return true;
+}
+
+void GraphicsAPI_Vulkan::FreeMemory(const MemoryAllocation &allocation) {
+    for (auto it = memoryBlocks.begin(); it != memoryBlocks.end(); it++) {
+        MemoryBlock &memoryBlock = *it;
+        if (memoryBlock.memory != allocation.memory) {
+            continue;
+        }
+
+        memoryBlock.allocationCount--;
+        memoryBlock.usedSize -= allocation.size;
+        if (memoryBlock.strategy == MemoryStrategy::LINEAR) {
+            if (memoryBlock.allocationCount == 0) {
+                memoryBlock.linearOffset = 0;
+            }
+        } else {
+            // Return the range to the free list and merge it with its neighbours.
+            VkDeviceSize offset = allocation.offset;
+            VkDeviceSize size = allocation.size;
+            auto next = memoryBlock.freeRanges.lower_bound(offset);
+            if (next != memoryBlock.freeRanges.end() && offset + size == next->first) {
+                size += next->second;
+                next = memoryBlock.freeRanges.erase(next);
+            }
+            if (next != memoryBlock.freeRanges.begin() && std::prev(next)->first + std::prev(next)->second == offset) {
+                std::prev(next)->second += size;
+            } else {
+                memoryBlock.freeRanges[offset] = size;
+            }
+        }
+
+        // Release empty blocks, but keep one block of each kind around to avoid reallocating it for the next resource.
+        if (memoryBlock.allocationCount == 0) {
+            uint32_t sameKindCount = 0;
+            for (const MemoryBlock &otherBlock : memoryBlocks) {
+                if (otherBlock.memoryTypeIndex == memoryBlock.memoryTypeIndex && otherBlock.strategy == memoryBlock.strategy && otherBlock.image == memoryBlock.image && !otherBlock.dedicated) {
+                    sameKindCount++;
+                }
+            }
+            if (memoryBlock.dedicated || sameKindCount > 1) {
+                DestroyMemoryBlock(memoryBlock);
+                memoryBlocks.erase(it);
+            }
+        }
+        return;
+    }
+}
+
+void GraphicsAPI_Vulkan::DestroyMemoryBlock(MemoryBlock &memoryBlock) {
+    if (memoryBlock.mappedData) {
+        vkUnmapMemory(device, memoryBlock.memory);
+        memoryBlock.mappedData = nullptr;
+    }
+    vkFreeMemory(device, memoryBlock.memory, nullptr);
+    memoryBlock.memory = VK_NULL_HANDLE;
+}
+
+std::vector<GraphicsAPI_Vulkan::MemoryStats> GraphicsAPI_Vulkan::GetMemoryStats() const {
+    std::vector<MemoryStats> memoryStats;
+    for (uint32_t i = 0; i < physicalDeviceMemoryProperties.memoryTypeCount; i++) {
+        MemoryStats stats{};
+        stats.memoryTypeIndex = i;
+        for (const MemoryBlock &memoryBlock : memoryBlocks) {
+            if (memoryBlock.memoryTypeIndex != i) {
+                continue;
+            }
+            stats.blockCount++;
+            stats.allocationCount += memoryBlock.allocationCount;
+            stats.blockSize += memoryBlock.size;
+            stats.usedSize += memoryBlock.usedSize;
+            if (memoryBlock.strategy == MemoryStrategy::LINEAR) {
+                // Space freed in the middle of a linear block isn't reusable until the block is rewound, so only the tail counts as free.
+                const VkDeviceSize freeSize = memoryBlock.size - memoryBlock.linearOffset;
+                if (freeSize > 0) {
+                    stats.freeRangeCount++;
+                    stats.freeSize += freeSize;
+                    stats.largestFreeRange = std::max(stats.largestFreeRange, freeSize);
+                }
+            } else {
+                for (const auto &freeRange : memoryBlock.freeRanges) {
+                    stats.freeRangeCount++;
+                    stats.freeSize += freeRange.second;
+                    stats.largestFreeRange = std::max(stats.largestFreeRange, freeRange.second);
+                }
+            }
+        }
+        if (stats.blockCount > 0) {
+            memoryStats.push_back(stats);
+        }
+    }
+    return memoryStats;
+}
+
+void GraphicsAPI_Vulkan::CreateUploadContext() {
+    // Use a dedicated transfer queue family for uploads, if the device has one.
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties;
+    uint32_t queueFamilyPropertiesCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, nullptr);
+    queueFamilyProperties.resize(queueFamilyPropertiesCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyPropertiesCount, queueFamilyProperties.data());
+    for (uint32_t i = 0; i < queueFamilyPropertiesCount; i++) {
+        const VkQueueFlags queueFlags = queueFamilyProperties[i].queueFlags;
+        if (BitwiseCheck(queueFlags, VkQueueFlags(VK_QUEUE_TRANSFER_BIT)) && !(queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && queueFamilyProperties[i].queueCount > 0) {
+            transferQueueFamilyIndex = i;
+            vkGetDeviceQueue(device, transferQueueFamilyIndex, 0, &transferQueue);
+            break;
+        }
+    }
+
     VkCommandPoolCreateInfo cmdPoolCI;
     cmdPoolCI.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     cmdPoolCI.pNext = nullptr;
-    cmdPoolCI.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    cmdPoolCI.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     cmdPoolCI.queueFamilyIndex = queueFamilyIndex;
-    VULKAN_CHECK(vkCreateCommandPool(device, &cmdPoolCI, nullptr, &cmdPool), "Failed to create CommandPool.");
+    VULKAN_CHECK(vkCreateCommandPool(device, &cmdPoolCI, nullptr, &uploadCmdPool), "Failed to create CommandPool.");
+    if (transferQueue) {
+        cmdPoolCI.queueFamilyIndex = transferQueueFamilyIndex;
+        VULKAN_CHECK(vkCreateCommandPool(device, &cmdPoolCI, nullptr, &transferCmdPool), "Failed to create CommandPool.");
+    }
+
+    VkFenceCreateInfo fenceCI;
+    fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceCI.pNext = nullptr;
+    fenceCI.flags = 0;
+    VULKAN_CHECK(vkCreateFence(device, &fenceCI, nullptr, &uploadFence), "Failed to create Fence.")
+}
+
+void GraphicsAPI_Vulkan::DestroyUploadContext() {
+    vkDestroyFence(device, uploadFence, nullptr);
+    if (transferCmdPool) {
+        vkDestroyCommandPool(device, transferCmdPool, nullptr);
+    }
+    vkDestroyCommandPool(device, uploadCmdPool, nullptr);
+}
 
+VkCommandBuffer GraphicsAPI_Vulkan::BeginUploadCommandBuffer(VkCommandPool cmdPool) {
+    VkCommandBuffer uploadCmdBuffer{};
     VkCommandBufferAllocateInfo allocateInfo;
     allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocateInfo.pNext = nullptr;
     allocateInfo.commandPool = cmdPool;
     allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
     allocateInfo.commandBufferCount = 1;
-    VULKAN_CHECK(vkAllocateCommandBuffers(device, &allocateInfo, &cmdBuffer), "Failed to allocate CommandBuffers.");
+    VULKAN_CHECK(vkAllocateCommandBuffers(device, &allocateInfo, &uploadCmdBuffer), "Failed to allocate CommandBuffers.");
 
-    vkGetDeviceQueue(device, queueFamilyIndex, queueIndex, &queue);
+    VkCommandBufferBeginInfo beginInfo;
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.pNext = nullptr;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = nullptr;
+    VULKAN_CHECK(vkBeginCommandBuffer(uploadCmdBuffer, &beginInfo), "Failed to begin CommandBuffer.");
+    return uploadCmdBuffer;
+}
 
-    VkFenceCreateInfo fenceCI{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
-    fenceCI.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceCI.pNext = nullptr;
-    fenceCI.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    VULKAN_CHECK(vkCreateFence(device, &fenceCI, nullptr, &fence), "Failed to create Fence.")
+void GraphicsAPI_Vulkan::SubmitUploadCommandBuffer(VkQueue uploadQueue, VkCommandPool cmdPool, VkCommandBuffer uploadCmdBuffer) {
+    VULKAN_CHECK(vkEndCommandBuffer(uploadCmdBuffer), "Failed to end CommandBuffer.");
 
+    VkSubmitInfo submitInfo;
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = nullptr;
+    submitInfo.waitSemaphoreCount = 0;
+    submitInfo.pWaitSemaphores = nullptr;
+    submitInfo.pWaitDstStageMask = nullptr;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &uploadCmdBuffer;
+    submitInfo.signalSemaphoreCount = 0;
+    submitInfo.pSignalSemaphores = nullptr;
+    VULKAN_CHECK(vkQueueSubmit(uploadQueue, 1, &submitInfo, uploadFence), "Failed to submit to Queue.");
+
+    // Uploads are expected at load time, so simply wait for them to finish.
+    VULKAN_CHECK(vkWaitForFences(device, 1, &uploadFence, true, UINT64_MAX), "Failed to wait for Fence");
+    VULKAN_CHECK(vkResetFences(device, 1, &uploadFence), "Failed to reset Fence.");
+    vkFreeCommandBuffers(device, cmdPool, 1, &uploadCmdBuffer);
+}
+
+void GraphicsAPI_Vulkan::UploadBufferData(VkBuffer buffer, size_t offset, size_t size, const void *data, bool useTransferQueue) {
+    // Staging Buffer
+    VkBuffer stagingBuffer{};
+    VkBufferCreateInfo stagingBufferCI;
+    stagingBufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    stagingBufferCI.pNext = nullptr;
+    stagingBufferCI.flags = 0;
+    stagingBufferCI.size = static_cast<VkDeviceSize>(size);
+    stagingBufferCI.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    stagingBufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    stagingBufferCI.queueFamilyIndexCount = 0;
+    stagingBufferCI.pQueueFamilyIndices = nullptr;
+    VULKAN_CHECK(vkCreateBuffer(device, &stagingBufferCI, nullptr, &stagingBuffer), "Failed to create Buffer.");
+
+    VkMemoryRequirements memoryRequirements{};
+    vkGetBufferMemoryRequirements(device, stagingBuffer, &memoryRequirements);
+    MemoryAllocation stagingAllocation = AllocateMemory(memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryStrategy::FREE_LIST, false);
+    VULKAN_CHECK(vkBindBufferMemory(device, stagingBuffer, stagingAllocation.memory, stagingAllocation.offset), "Failed to bind Memory to Buffer.");
+    memcpy(stagingAllocation.mappedData, data, size);
+
+    // Copy
+    const bool transfer = useTransferQueue && transferQueue;
+    VkCommandBuffer uploadCmdBuffer = BeginUploadCommandBuffer(transfer ? transferCmdPool : uploadCmdPool);
+    VkBufferCopy bufferCopy;
+    bufferCopy.srcOffset = 0;
+    bufferCopy.dstOffset = static_cast<VkDeviceSize>(offset);
+    bufferCopy.size = static_cast<VkDeviceSize>(size);
+    vkCmdCopyBuffer(uploadCmdBuffer, stagingBuffer, buffer, 1, &bufferCopy);
+
+    // Make the copy visible to vertex input and shader reads. On the transfer queue, the barrier is split into a release by the
+    // transfer queue family and an acquire by the graphics queue family, as the buffer is created with VK_SHARING_MODE_EXCLUSIVE.
+    const VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    VkBufferMemoryBarrier bufferBarrier;
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.pNext = nullptr;
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+    bufferBarrier.srcQueueFamilyIndex = transfer ? transferQueueFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = transfer ? queueFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = buffer;
+    bufferBarrier.offset = static_cast<VkDeviceSize>(offset);
+    bufferBarrier.size = static_cast<VkDeviceSize>(size);
+    if (transfer) {
+        VkBufferMemoryBarrier releaseBarrier = bufferBarrier;
+        releaseBarrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(uploadCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VkDependencyFlagBits(0), 0, nullptr, 1, &releaseBarrier, 0, nullptr);
+        SubmitUploadCommandBuffer(transferQueue, transferCmdPool, uploadCmdBuffer);
+
+        VkBufferMemoryBarrier acquireBarrier = bufferBarrier;
+        acquireBarrier.srcAccessMask = 0;
+        uploadCmdBuffer = BeginUploadCommandBuffer(uploadCmdPool);
+        vkCmdPipelineBarrier(uploadCmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStageMask, VkDependencyFlagBits(0), 0, nullptr, 1, &acquireBarrier, 0, nullptr);
+    } else {
+        vkCmdPipelineBarrier(uploadCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask, VkDependencyFlagBits(0), 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+    }
+    SubmitUploadCommandBuffer(queue, uploadCmdPool, uploadCmdBuffer);
+
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    FreeMemory(stagingAllocation);
+}
+
+VkDescriptorPool GraphicsAPI_Vulkan::CreateDescriptorPool() {
     uint32_t maxSets = 1024;
     std::vector<VkDescriptorPoolSize> poolSizes{
         {VK_DESCRIPTOR_TYPE_SAMPLER, 16 * maxSets},
@@ -403,28 +873,116 @@ GraphicsAPI_Vulkan::GraphicsAPI_Vulkan(XrInstance m_xrInstance, XrSystemId syste
         {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 16 * maxSets},
         {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 16 * maxSets}};
 
+    // Descriptor sets are never freed individually. The pools of a frame context are reset as a whole, when its descriptor set cache is dropped.
+    VkDescriptorPool descriptorPool{};
     VkDescriptorPoolCreateInfo descPoolCI;
     descPoolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     descPoolCI.pNext = nullptr;
-    descPoolCI.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    descPoolCI.flags = 0;
     descPoolCI.maxSets = maxSets;
     descPoolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     descPoolCI.pPoolSizes = poolSizes.data();
     VULKAN_CHECK(vkCreateDescriptorPool(device, &descPoolCI, nullptr, &descriptorPool), "Failed to create DescriptorPool");
+    return descriptorPool;
 }
 
-GraphicsAPI_Vulkan::~GraphicsAPI_Vulkan() {
-    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+VkDescriptorSet GraphicsAPI_Vulkan::AllocateDescriptorSet(VkDescriptorSetLayout descSetLayout) {
+    FrameContext &frameContext = frameContexts[frameContextIndex];
+
+    VkDescriptorSet descSet{};
+    VkDescriptorSetAllocateInfo descSetAI;
+    descSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descSetAI.pNext = nullptr;
+    descSetAI.descriptorSetCount = 1;
+    descSetAI.pSetLayouts = &descSetLayout;
 
-    vkDestroyFence(device, fence, nullptr);
+    // Allocate from the current pool, moving on to the next one, or creating a new one, when it's full.
+    while (true) {
+        if (frameContext.descriptorPoolIndex == frameContext.descriptorPools.size()) {
+            frameContext.descriptorPools.push_back(CreateDescriptorPool());
+        }
+        descSetAI.descriptorPool = frameContext.descriptorPools[frameContext.descriptorPoolIndex];
+        VkResult result = vkAllocateDescriptorSets(device, &descSetAI, &descSet);
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+            frameContext.descriptorPoolIndex++;
+            continue;
+        }
+        VULKAN_CHECK(result, "Failed to allocate DescriptorSet.");
+        break;
+    }
+    return descSet;
+}
 
-    vkFreeCommandBuffers(device, cmdPool, 1, &cmdBuffer);
-    vkDestroyCommandPool(device, cmdPool, nullptr);
+void GraphicsAPI_Vulkan::InvalidateDescriptorSetCaches() {
+    // Cached sets may refer to a destroyed resource, whose handle value could be reused. Forget them now and reset the pools once the GPU is done with them.
+    for (FrameContext &frameContext : frameContexts) {
+        frameContext.descriptorSetCache.clear();
+        frameContext.resetDescriptorSetCache = true;
+    }
+    // The current descriptors may refer to it too, so they must be set again.
+    currentDescriptors.clear();
+}
 
-    vkDestroyDevice(device, nullptr);
-    vkDestroyInstance(instance, nullptr);
+void GraphicsAPI_Vulkan::InvalidateFramebuffers(VkRenderPass renderPass, VkImageView imageView) {
+    // Earlier frames may still use the framebuffers, so they're destroyed once the GPU is done with the current frame context.
+    for (auto it = framebufferCache.begin(); it != framebufferCache.end();) {
+        const std::vector<VkImageView> &imageViews = std::get<1>(it->first);
+        if (std::get<0>(it->first) == renderPass || std::find(imageViews.begin(), imageViews.end(), imageView) != imageViews.end()) {
+            GetDeferredDestroys().framebuffers.push_back(it->second);
+            it = framebufferCache.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+GraphicsAPI_Vulkan::DeferredDestroys &GraphicsAPI_Vulkan::GetDeferredDestroys() {
+    // Submissions complete in order, so once the current frame context's fence has signalled, the GPU is done with everything submitted before it too.
+    return frameContexts[frameContextIndex].deferredDestroys;
+}
+
+void GraphicsAPI_Vulkan::DestroyDeferredObjects(DeferredDestroys &deferredDestroys) {
+    for (const VkFramebuffer &framebuffer : deferredDestroys.framebuffers) {
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+    for (const VkPipeline &pipeline : deferredDestroys.pipelines) {
+        vkDestroyPipeline(device, pipeline, nullptr);
+    }
+    for (const VkPipelineLayout &pipelineLayout : deferredDestroys.pipelineLayouts) {
+        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    }
+    for (const VkDescriptorUpdateTemplateKHR &descUpdateTemplate : deferredDestroys.descUpdateTemplates) {
+        vkDestroyDescriptorUpdateTemplateKHR(device, descUpdateTemplate, nullptr);
+    }
+    for (const VkDescriptorSetLayout &descSetLayout : deferredDestroys.descSetLayouts) {
+        vkDestroyDescriptorSetLayout(device, descSetLayout, nullptr);
+    }
+    for (const VkRenderPass &renderPass : deferredDestroys.renderPasses) {
+        vkDestroyRenderPass(device, renderPass, nullptr);
+    }
+    for (const VkImageView &imageView : deferredDestroys.imageViews) {
+        vkDestroyImageView(device, imageView, nullptr);
+    }
+    for (const VkSampler &sampler : deferredDestroys.samplers) {
+        vkDestroySampler(device, sampler, nullptr);
+    }
+    for (const VkBuffer &buffer : deferredDestroys.buffers) {
+        vkDestroyBuffer(device, buffer, nullptr);
+    }
+    for (const VkImage &image : deferredDestroys.images) {
+        vkDestroyImage(device, image, nullptr);
+    }
+    for (const MemoryAllocation &allocation : deferredDestroys.memoryAllocations) {
+        FreeMemory(allocation);
+    }
+    deferredDestroys = DeferredDestroys();
+}
+
+void GraphicsAPI_Vulkan::SetFramesInFlight(uint32_t framesInFlight) {
+    VULKAN_CHECK(vkDeviceWaitIdle(device), "Failed to wait for Device.");
+    DestroyFrameContexts();
+    CreateFrameContexts(framesInFlight);
 }
-// XR_DOCS_TAG_END_GraphicsAPI_Vulkan
 
 void *GraphicsAPI_Vulkan::CreateDesktopSwapchain(const SwapchainCreateInfo &swapchainCI) {
     VkSurfaceKHR surface{};
@@ -541,11 +1099,10 @@ void GraphicsAPI_Vulkan::AcquireDesktopSwapchanImage(void *swapchain, uint32_t &
     VULKAN_CHECK(vkAcquireNextImageKHR(device, (VkSwapchainKHR)swapchain, UINT64_MAX, acquireSemaphore, VK_NULL_HANDLE, &index), "Failed to acquire next Image from Swapchain.");
 
     currentDesktopSwapchainImage = (VkImage)GetDesktopSwapchainImage(swapchain, index);
-    imageStates[currentDesktopSwapchainImage] = VK_IMAGE_LAYOUT_UNDEFINED;
+    currentDesktopSwapchainImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 }
 
 void GraphicsAPI_Vulkan::PresentDesktopSwapchainImage(void *swapchain, uint32_t index) {
-    imageStates.erase(currentDesktopSwapchainImage);
     currentDesktopSwapchainImage = VK_NULL_HANDLE;
 
     VkQueue queue{};
@@ -608,32 +1165,19 @@ void *GraphicsAPI_Vulkan::CreateImage(const ImageCreateInfo &imageCI) {
     VkMemoryRequirements memoryRequirements{};
     vkGetImageMemoryRequirements(device, image, &memoryRequirements);
 
-    VkDeviceMemory memory{};
-    VkMemoryAllocateInfo allocateInfo;
-    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocateInfo.pNext = nullptr;
-    allocateInfo.allocationSize = memoryRequirements.size;
-
-    VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties{};
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &physicalDeviceMemoryProperties);
-    MemoryTypeFromProperties(physicalDeviceMemoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocateInfo.memoryTypeIndex);
-
-    VULKAN_CHECK(vkAllocateMemory(device, &allocateInfo, nullptr, &memory), "Failed to allocate Memory.");
-    VULKAN_CHECK(vkBindImageMemory(device, image, memory, 0), "Failed to bind Memory to Image.");
+    MemoryAllocation allocation = AllocateMemory(memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryStrategy::FREE_LIST, true);
+    VULKAN_CHECK(vkBindImageMemory(device, image, allocation.memory, allocation.offset), "Failed to bind Memory to Image.");
 
-    imageResources[image] = {memory, imageCI};
-    imageStates[image] = vkImageCI.initialLayout;
+    imageResources[image] = {allocation, imageCI};
 
     return (void *)image;
 }
 
 void GraphicsAPI_Vulkan::DestroyImage(void *&image) {
     VkImage vkImage = (VkImage)image;
-    VkDeviceMemory memory = imageResources[vkImage].first;
-    vkFreeMemory(device, memory, nullptr);
-    vkDestroyImage(device, vkImage, nullptr);
+    GetDeferredDestroys().images.push_back(vkImage);
+    GetDeferredDestroys().memoryAllocations.push_back(imageResources[vkImage].first);
     imageResources.erase(vkImage);
-    imageStates.erase(vkImage);
     image = nullptr;
 }
 
@@ -660,7 +1204,9 @@ void *GraphicsAPI_Vulkan::CreateImageView(const ImageViewCreateInfo &imageViewCI
 
 void GraphicsAPI_Vulkan::DestroyImageView(void *&imageView) {
     VkImageView vkImageView = (VkImageView)imageView;
-    vkDestroyImageView(device, vkImageView, nullptr);
+    InvalidateDescriptorSetCaches();
+    InvalidateFramebuffers(VK_NULL_HANDLE, vkImageView);
+    GetDeferredDestroys().imageViews.push_back(vkImageView);
     imageViewResources.erase(vkImageView);
     imageView = nullptr;
 }
@@ -695,11 +1241,16 @@ void *GraphicsAPI_Vulkan::CreateSampler(const SamplerCreateInfo &samplerCI) {
 }
 
 void GraphicsAPI_Vulkan::DestroySampler(void *&sampler) {
-    vkDestroySampler(device, (VkSampler)sampler, nullptr);
+    InvalidateDescriptorSetCaches();
+    GetDeferredDestroys().samplers.push_back((VkSampler)sampler);
     sampler = nullptr;
 }
 
-void *GraphicsAPI_Vulkan::CreateBuffer(const BufferCreateInfo &bufferCI) {
+GraphicsAPI::BufferHandle GraphicsAPI_Vulkan::CreateBuffer(const BufferCreateInfo &bufferCI) {
+    return CreateBuffer(bufferCI, MemoryStrategy::FREE_LIST);
+}
+
+GraphicsAPI::BufferHandle GraphicsAPI_Vulkan::CreateBuffer(const BufferCreateInfo &bufferCI, MemoryStrategy memoryStrategy) {
     VkBuffer buffer{};
     VkBufferCreateInfo vkBufferCI;
     vkBufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -715,32 +1266,35 @@ void *GraphicsAPI_Vulkan::CreateBuffer(const BufferCreateInfo &bufferCI) {
     VkMemoryRequirements memoryRequirements{};
     vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
 
-    VkDeviceMemory memory{};
-    VkMemoryAllocateInfo allocateInfo;
-    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocateInfo.pNext = nullptr;
-    allocateInfo.allocationSize = memoryRequirements.size;
-
-    VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties{};
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &physicalDeviceMemoryProperties);
-    MemoryTypeFromProperties(physicalDeviceMemoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &allocateInfo.memoryTypeIndex);
-
-    VULKAN_CHECK(vkAllocateMemory(device, &allocateInfo, nullptr, &memory), "Failed to allocate Memory.");
-    VULKAN_CHECK(vkBindBufferMemory(device, buffer, memory, 0), "Failed to bind Memory to Buffer.");
-
-    bufferResources[buffer] = {memory, bufferCI};
-    SetBufferData((void *)buffer, 0, bufferCI.size, bufferCI.data);
+    // STATIC buffers go into DEVICE_LOCAL memory. Others are HOST_VISIBLE, and their block stays mapped for the lifetime of the buffer,
+    // so SetBufferData() is just a memcpy. STREAM buffers prefer memory that is both, where the device has it.
+    VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    uint32_t memoryTypeIndex = 0;
+    if (bufferCI.usage == BufferCreateInfo::Usage::STATIC) {
+        memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    } else if (bufferCI.usage == BufferCreateInfo::Usage::STREAM && MemoryTypeFromProperties(physicalDeviceMemoryProperties, memoryRequirements.memoryTypeBits, memoryProperties | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &memoryTypeIndex)) {
+        memoryProperties |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    }
+    MemoryAllocation allocation = AllocateMemory(memoryRequirements, memoryProperties, memoryStrategy, false);
+    VULKAN_CHECK(vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset), "Failed to bind Memory to Buffer.");
+
+    BufferHandle handle = bufferResources.Insert({buffer, allocation, bufferCI});
+    if (allocation.mappedData) {
+        SetBufferData(handle, 0, bufferCI.size, bufferCI.data);
+    } else if (bufferCI.data) {
+        // The new buffer isn't in use by the device yet, so it can be uploaded to straight away.
+        UploadBufferData(buffer, 0, bufferCI.size, bufferCI.data, true);
+    }
 
-    return (void *)buffer;
+    return handle;
 }
 
-void GraphicsAPI_Vulkan::DestroyBuffer(void *&buffer) {
-    VkBuffer vkBuffer = (VkBuffer)buffer;
-    VkDeviceMemory memory = bufferResources[vkBuffer].first;
-    vkFreeMemory(device, memory, nullptr);
-    vkDestroyBuffer(device, vkBuffer, nullptr);
-    bufferResources.erase(vkBuffer);
-    buffer = nullptr;
+void GraphicsAPI_Vulkan::DestroyBuffer(BufferHandle &buffer) {
+    InvalidateDescriptorSetCaches();
+    GetDeferredDestroys().buffers.push_back(bufferResources[buffer].buffer);
+    GetDeferredDestroys().memoryAllocations.push_back(bufferResources[buffer].allocation);
+    bufferResources.Erase(buffer);
+    buffer = BufferHandle();
 }
 
 void *GraphicsAPI_Vulkan::CreateShader(const ShaderCreateInfo &shaderCI) {
@@ -754,45 +1308,54 @@ void *GraphicsAPI_Vulkan::CreateShader(const ShaderCreateInfo &shaderCI) {
     VULKAN_CHECK(vkCreateShaderModule(device, &shaderModuleCI, nullptr, &shaderModule), "Failed to create ShaderModule.");
 
     shaderResources[shaderModule] = shaderCI;
+
+    // Pipelines are keyed by the shader code, rather than by the handle, which can be reused once this module is destroyed.
+    std::string &shaderKey = shaderKeys[shaderModule];
+    AppendKey(shaderKey, shaderCI.type);
+    shaderKey.append(shaderCI.sourceData, shaderCI.sourceSize);
     return (void *)shaderModule;
 }
 
 void GraphicsAPI_Vulkan::DestroyShader(void *&shader) {
     VkShaderModule shaderModule = (VkShaderModule)shader;
     vkDestroyShaderModule(device, shaderModule, nullptr);
+    shaderResources.erase(shaderModule);
+    shaderKeys.erase(shaderModule);
     shader = nullptr;
 }
 
-void *GraphicsAPI_Vulkan::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
-    // RenderPass
+VkRenderPass GraphicsAPI_Vulkan::CreateRenderPass(const PipelineCreateInfo &pipelineCI, uint32_t clearAttachmentMask, bool storeDepth) {
+    // Attachments in clearAttachmentMask are cleared on load, so their previous contents and layout don't matter.
     std::vector<VkAttachmentDescription> attachmentDescriptions{};
     std::vector<VkAttachmentReference> colorAttachmentReferences{};
     VkAttachmentReference depthAttachmentReference;
     for (const auto &colorFormat : pipelineCI.colorFormats) {
+        const bool clear = BitwiseCheck(clearAttachmentMask, 1u << static_cast<uint32_t>(attachmentDescriptions.size()));
         attachmentDescriptions.push_back({
             static_cast<VkAttachmentDescriptionFlags>(0),
             static_cast<VkFormat>(colorFormat),
             static_cast<VkSampleCountFlagBits>(1),
-            VK_ATTACHMENT_LOAD_OP_LOAD,
+            clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD,
             VK_ATTACHMENT_STORE_OP_STORE,
             VK_ATTACHMENT_LOAD_OP_DONT_CARE,
             VK_ATTACHMENT_STORE_OP_DONT_CARE,
-            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            clear ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
         });
         colorAttachmentReferences.push_back({static_cast<uint32_t>(attachmentDescriptions.size() - 1),
                                              VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
     }
     if (pipelineCI.depthFormat) {
+        const bool clear = BitwiseCheck(clearAttachmentMask, 1u << static_cast<uint32_t>(attachmentDescriptions.size()));
         attachmentDescriptions.push_back({
             static_cast<VkAttachmentDescriptionFlags>(0),
             static_cast<VkFormat>(pipelineCI.depthFormat),
             static_cast<VkSampleCountFlagBits>(1),
-            VK_ATTACHMENT_LOAD_OP_LOAD,
-            VK_ATTACHMENT_STORE_OP_STORE,
+            clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD,
+            storeDepth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
             VK_ATTACHMENT_LOAD_OP_DONT_CARE,
             VK_ATTACHMENT_STORE_OP_DONT_CARE,
-            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            clear ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
             VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
         });
         depthAttachmentReference = {
@@ -815,10 +1378,10 @@ void *GraphicsAPI_Vulkan::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
     VkSubpassDependency subpassDependency;
     subpassDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     subpassDependency.dstSubpass = 0;
-    subpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependency.srcAccessMask = VkAccessFlagBits(0);
-    subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    subpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    subpassDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    subpassDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
     subpassDependency.dependencyFlags = VkDependencyFlagBits(0);
 
     VkRenderPass renderPass{};
@@ -834,9 +1397,29 @@ void *GraphicsAPI_Vulkan::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
     renderPassCI.pDependencies = &subpassDependency;
     VULKAN_CHECK(vkCreateRenderPass(device, &renderPassCI, nullptr, &renderPass), "Failed to create RenderPass.");
 
-    // Pipeline Layout and DescriptorSetLayout
+    return renderPass;
+}
+
+VkRenderPass GraphicsAPI_Vulkan::GetRenderPass(PipelineHandle pipeline, uint32_t clearAttachmentMask) {
+    VkRenderPass renderPass = pipelineResources[pipeline].renderPass;
+    if (clearAttachmentMask == 0 && storeDepthAttachment) {
+        return renderPass;
+    }
+
+    // Variants only differ in load/store operations and layouts, so they're compatible with the pipeline and its framebuffers.
+    auto renderPassVariantKey = std::make_tuple(renderPass, clearAttachmentMask, storeDepthAttachment);
+    auto it = renderPassVariants.find(renderPassVariantKey);
+    if (it != renderPassVariants.end()) {
+        return it->second;
+    }
+    VkRenderPass renderPassVariant = CreateRenderPass(pipelineResources[pipeline].pipelineCI, clearAttachmentMask, storeDepthAttachment);
+    renderPassVariants[renderPassVariantKey] = renderPassVariant;
+    return renderPassVariant;
+}
+
+VkDescriptorSetLayout GraphicsAPI_Vulkan::CreateDescriptorSetLayout(const std::vector<DescriptorInfo> &layout) {
     std::vector<VkDescriptorSetLayoutBinding> descSetLayouBindings;
-    for (const DescriptorInfo &descInfo : pipelineCI.layout) {
+    for (const DescriptorInfo &descInfo : layout) {
         VkDescriptorSetLayoutBinding descSetLayouBinding;
         descSetLayouBinding.binding = descInfo.bindingIndex;
         descSetLayouBinding.descriptorType = ToVkDescrtiptorType(descInfo);
@@ -855,16 +1438,224 @@ void *GraphicsAPI_Vulkan::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
     descSetLayoutCI.pBindings = descSetLayouBindings.data();
     VULKAN_CHECK(vkCreateDescriptorSetLayout(device, &descSetLayoutCI, nullptr, &descSetLayout), "Failed to create PipelineLayout.");
 
+    // DescriptorUpdateTemplate: reads an array of DescriptorData, one element per entry in the layout.
+    VkDescriptorUpdateTemplateKHR descUpdateTemplate = VK_NULL_HANDLE;
+    if (vkCreateDescriptorUpdateTemplateKHR && !layout.empty()) {
+        std::vector<VkDescriptorUpdateTemplateEntryKHR> descUpdateTemplateEntries;
+        for (size_t i = 0; i < layout.size(); i++) {
+            const DescriptorInfo &descInfo = layout[i];
+            VkDescriptorUpdateTemplateEntryKHR descUpdateTemplateEntry;
+            descUpdateTemplateEntry.dstBinding = descInfo.bindingIndex;
+            descUpdateTemplateEntry.dstArrayElement = 0;
+            descUpdateTemplateEntry.descriptorCount = 1;
+            descUpdateTemplateEntry.descriptorType = ToVkDescrtiptorType(descInfo);
+            descUpdateTemplateEntry.offset = i * sizeof(DescriptorData) + (descInfo.type == DescriptorInfo::Type::BUFFER ? offsetof(DescriptorData, bufferInfo) : offsetof(DescriptorData, imageInfo));
+            descUpdateTemplateEntry.stride = sizeof(DescriptorData);
+            descUpdateTemplateEntries.push_back(descUpdateTemplateEntry);
+        }
+
+        VkDescriptorUpdateTemplateCreateInfoKHR descUpdateTemplateCI;
+        descUpdateTemplateCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+        descUpdateTemplateCI.pNext = nullptr;
+        descUpdateTemplateCI.flags = 0;
+        descUpdateTemplateCI.descriptorUpdateEntryCount = static_cast<uint32_t>(descUpdateTemplateEntries.size());
+        descUpdateTemplateCI.pDescriptorUpdateEntries = descUpdateTemplateEntries.data();
+        descUpdateTemplateCI.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+        descUpdateTemplateCI.descriptorSetLayout = descSetLayout;
+        descUpdateTemplateCI.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        descUpdateTemplateCI.pipelineLayout = VK_NULL_HANDLE;
+        descUpdateTemplateCI.set = 0;
+        VULKAN_CHECK(vkCreateDescriptorUpdateTemplateKHR(device, &descUpdateTemplateCI, nullptr, &descUpdateTemplate), "Failed to create DescriptorUpdateTemplate.");
+    }
+    descSetLayoutUpdateTemplates[descSetLayout] = descUpdateTemplate;
+
+    return descSetLayout;
+}
+
+uint32_t GraphicsAPI_Vulkan::GetDescriptorSetCount(const std::vector<DescriptorInfo> &layout) {
+    uint32_t setCount = 0;
+    for (const DescriptorInfo &descInfo : layout) {
+        setCount = std::max(setCount, descInfo.set + 1);
+    }
+    return setCount;
+}
+
+GraphicsAPI_Vulkan::PipelineKeys GraphicsAPI_Vulkan::GetPipelineKeys(const PipelineCreateInfo &pipelineCI) {
+    // Only the state that Vulkan consumes is part of the keys, e.g. semantic names and descriptor resources are not.
+    PipelineKeys keys;
+
+    AppendKey(keys.renderPass, pipelineCI.colorFormats.size());
+    for (const int64_t &colorFormat : pipelineCI.colorFormats) {
+        AppendKey(keys.renderPass, colorFormat);
+    }
+    AppendKey(keys.renderPass, pipelineCI.depthFormat);
+
+    // Sets without any descriptors get an empty layout, so that the set numbers match the shaders.
+    keys.descSetLayouts.resize(GetDescriptorSetCount(pipelineCI.layout));
+    for (const DescriptorInfo &descInfo : pipelineCI.layout) {
+        std::string &descSetLayoutKey = keys.descSetLayouts[descInfo.set];
+        AppendKey(descSetLayoutKey, descInfo.bindingIndex);
+        AppendKey(descSetLayoutKey, ToVkDescrtiptorType(descInfo));
+        AppendKey(descSetLayoutKey, descInfo.stage);
+    }
+
+    AppendKey(keys.pipelineLayout, keys.descSetLayouts.size());
+    for (const std::string &descSetLayoutKey : keys.descSetLayouts) {
+        AppendKey(keys.pipelineLayout, descSetLayoutKey.size());
+        keys.pipelineLayout += descSetLayoutKey;
+    }
+    AppendKey(keys.pipelineLayout, pipelineCI.pushConstantRanges.size());
+    for (const PushConstantRange &pushConstantRange : pipelineCI.pushConstantRanges) {
+        AppendKey(keys.pipelineLayout, pushConstantRange.stage);
+        AppendKey(keys.pipelineLayout, pushConstantRange.offset);
+        AppendKey(keys.pipelineLayout, pushConstantRange.size);
+    }
+
+    std::string &key = keys.pipeline;
+    key = keys.renderPass + keys.pipelineLayout;
+    AppendKey(key, pipelineCI.shaders.size());
+    for (void *shader : pipelineCI.shaders) {
+        auto it = shaderKeys.find((VkShaderModule)shader);
+        if (it != shaderKeys.end()) {
+            AppendKey(key, it->second.size());
+            key += it->second;
+        } else {
+            AppendKey(key, shader);
+        }
+    }
+    AppendKey(key, pipelineCI.vertexInputState.attributes.size());
+    for (const VertexInputAttribute &attribute : pipelineCI.vertexInputState.attributes) {
+        AppendKey(key, attribute.attribIndex);
+        AppendKey(key, attribute.bindingIndex);
+        AppendKey(key, attribute.vertexType);
+        AppendKey(key, attribute.offset);
+    }
+    AppendKey(key, pipelineCI.vertexInputState.bindings.size());
+    for (const VertexInputBinding &binding : pipelineCI.vertexInputState.bindings) {
+        AppendKey(key, binding.bindingIndex);
+        AppendKey(key, binding.stride);
+        AppendKey(key, binding.inputRate);
+    }
+    AppendKey(key, pipelineCI.inputAssemblyState.topology);
+    AppendKey(key, pipelineCI.inputAssemblyState.primitiveRestartEnable);
+
+    const RasterisationState &rasterisationState = pipelineCI.rasterisationState;
+    AppendKey(key, rasterisationState.depthClampEnable);
+    AppendKey(key, rasterisationState.rasteriserDiscardEnable);
+    AppendKey(key, rasterisationState.polygonMode);
+    AppendKey(key, rasterisationState.cullMode);
+    AppendKey(key, rasterisationState.frontFace);
+    AppendKey(key, rasterisationState.depthBiasEnable);
+    AppendKey(key, rasterisationState.depthBiasConstantFactor);
+    AppendKey(key, rasterisationState.depthBiasClamp);
+    AppendKey(key, rasterisationState.depthBiasSlopeFactor);
+    AppendKey(key, rasterisationState.lineWidth);
+
+    const MultisampleState &multisampleState = pipelineCI.multisampleState;
+    AppendKey(key, multisampleState.rasterisationSamples);
+    AppendKey(key, multisampleState.sampleShadingEnable);
+    AppendKey(key, multisampleState.minSampleShading);
+    AppendKey(key, multisampleState.sampleMask);
+    AppendKey(key, multisampleState.alphaToCoverageEnable);
+    AppendKey(key, multisampleState.alphaToOneEnable);
+
+    const DepthStencilState &depthStencilState = pipelineCI.depthStencilState;
+    AppendKey(key, depthStencilState.depthTestEnable);
+    AppendKey(key, depthStencilState.depthWriteEnable);
+    AppendKey(key, depthStencilState.depthCompareOp);
+    AppendKey(key, depthStencilState.depthBoundsTestEnable);
+    AppendKey(key, depthStencilState.stencilTestEnable);
+    for (const StencilOpState *stencilOpState : {&depthStencilState.front, &depthStencilState.back}) {
+        AppendKey(key, stencilOpState->failOp);
+        AppendKey(key, stencilOpState->passOp);
+        AppendKey(key, stencilOpState->depthFailOp);
+        AppendKey(key, stencilOpState->compareOp);
+        AppendKey(key, stencilOpState->compareMask);
+        AppendKey(key, stencilOpState->writeMask);
+        AppendKey(key, stencilOpState->reference);
+    }
+    AppendKey(key, depthStencilState.minDepthBounds);
+    AppendKey(key, depthStencilState.maxDepthBounds);
+
+    const ColorBlendState &colorBlendState = pipelineCI.colorBlendState;
+    AppendKey(key, colorBlendState.logicOpEnable);
+    AppendKey(key, colorBlendState.logicOp);
+    AppendKey(key, colorBlendState.attachments.size());
+    for (const ColorBlendAttachmentState &attachment : colorBlendState.attachments) {
+        AppendKey(key, attachment.blendEnable);
+        AppendKey(key, attachment.srcColorBlendFactor);
+        AppendKey(key, attachment.dstColorBlendFactor);
+        AppendKey(key, attachment.colorBlendOp);
+        AppendKey(key, attachment.srcAlphaBlendFactor);
+        AppendKey(key, attachment.dstAlphaBlendFactor);
+        AppendKey(key, attachment.alphaBlendOp);
+        AppendKey(key, attachment.colorWriteMask);
+    }
+    for (const float &blendConstant : colorBlendState.blendConstants) {
+        AppendKey(key, blendConstant);
+    }
+
+    return keys;
+}
+
+GraphicsAPI::PipelineHandle GraphicsAPI_Vulkan::CreatePipeline(const PipelineCreateInfo &createInfo) {
+    // Canonicalize the description, so that the declaration order of bindings and attributes doesn't change the keys.
+    PipelineCreateInfo pipelineCI = createInfo;
+    std::stable_sort(pipelineCI.layout.begin(), pipelineCI.layout.end(), [](const DescriptorInfo &a, const DescriptorInfo &b) { return a.set != b.set ? a.set < b.set : a.bindingIndex < b.bindingIndex; });
+    std::stable_sort(pipelineCI.vertexInputState.attributes.begin(), pipelineCI.vertexInputState.attributes.end(), [](const VertexInputAttribute &a, const VertexInputAttribute &b) { return a.attribIndex < b.attribIndex; });
+    std::stable_sort(pipelineCI.vertexInputState.bindings.begin(), pipelineCI.vertexInputState.bindings.end(), [](const VertexInputBinding &a, const VertexInputBinding &b) { return a.bindingIndex < b.bindingIndex; });
+
+    // Equivalent pipelines, and the objects they are built from, are shared and reference counted.
+    PipelineKeys keys = GetPipelineKeys(pipelineCI);
+    PipelineResource sharedPipelineResource;
+    if (AcquireSharedObject(sharedPipelines, keys.pipeline, sharedPipelineResource)) {
+        return pipelineResources.Insert(sharedPipelineResource);
+    }
+
+    // RenderPass
+    VkRenderPass renderPass{};
+    if (!AcquireSharedObject(sharedRenderPasses, keys.renderPass, renderPass)) {
+        renderPass = CreateRenderPass(pipelineCI, 0, true);
+        sharedRenderPasses[keys.renderPass] = {renderPass, 1};
+    }
+
+    // Pipeline Layout and DescriptorSetLayouts
+    std::vector<VkDescriptorSetLayout> descSetLayouts(keys.descSetLayouts.size());
+    for (uint32_t set = 0; set < static_cast<uint32_t>(descSetLayouts.size()); set++) {
+        if (!AcquireSharedObject(sharedDescSetLayouts, keys.descSetLayouts[set], descSetLayouts[set])) {
+            std::vector<DescriptorInfo> setLayout;
+            for (const DescriptorInfo &descInfo : pipelineCI.layout) {
+                if (descInfo.set == set) {
+                    setLayout.push_back(descInfo);
+                }
+            }
+            descSetLayouts[set] = CreateDescriptorSetLayout(setLayout);
+            sharedDescSetLayouts[keys.descSetLayouts[set]] = {descSetLayouts[set], 1};
+        }
+    }
+
     VkPipelineLayout pipelineLayout{};
-    VkPipelineLayoutCreateInfo PLCI{};
-    PLCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    PLCI.pNext = nullptr;
-    PLCI.flags = 0;
-    PLCI.setLayoutCount = 1;
-    PLCI.pSetLayouts = &descSetLayout;
-    PLCI.pushConstantRangeCount = 0;
-    PLCI.pPushConstantRanges = nullptr;
-    VULKAN_CHECK(vkCreatePipelineLayout(device, &PLCI, nullptr, &pipelineLayout), "Failed to create PipelineLayout.");
+    if (!AcquireSharedObject(sharedPipelineLayouts, keys.pipelineLayout, pipelineLayout)) {
+        std::vector<VkPushConstantRange> pushConstantRanges;
+        for (const PushConstantRange &pushConstantRange : pipelineCI.pushConstantRanges) {
+            VkPushConstantRange vkPushConstantRange;
+            vkPushConstantRange.stageFlags = static_cast<VkShaderStageFlags>(1 << (uint32_t)pushConstantRange.stage);
+            vkPushConstantRange.offset = pushConstantRange.offset;
+            vkPushConstantRange.size = pushConstantRange.size;
+            pushConstantRanges.push_back(vkPushConstantRange);
+        }
+
+        VkPipelineLayoutCreateInfo PLCI{};
+        PLCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        PLCI.pNext = nullptr;
+        PLCI.flags = 0;
+        PLCI.setLayoutCount = static_cast<uint32_t>(descSetLayouts.size());
+        PLCI.pSetLayouts = descSetLayouts.data();
+        PLCI.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+        PLCI.pPushConstantRanges = pushConstantRanges.data();
+        VULKAN_CHECK(vkCreatePipelineLayout(device, &PLCI, nullptr, &pipelineLayout), "Failed to create PipelineLayout.");
+        sharedPipelineLayouts[keys.pipelineLayout] = {pipelineLayout, 1};
+    }
 
     // ShaderStages
     std::vector<VkPipelineShaderStageCreateInfo> vkShaderStages;
@@ -886,7 +1677,7 @@ void *GraphicsAPI_Vulkan::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
     std::vector<VkVertexInputBindingDescription> vkVertexInputBindingDescriptions;
     vkVertexInputBindingDescriptions.reserve(pipelineCI.vertexInputState.bindings.size());
     for (auto &binding : pipelineCI.vertexInputState.bindings)
-        vkVertexInputBindingDescriptions.push_back({binding.bindingIndex, (uint32_t)binding.stride, VK_VERTEX_INPUT_RATE_VERTEX});
+        vkVertexInputBindingDescriptions.push_back({binding.bindingIndex, (uint32_t)binding.stride, binding.inputRate == VertexInputRate::INSTANCE ? VK_VERTEX_INPUT_RATE_INSTANCE : VK_VERTEX_INPUT_RATE_VERTEX});
 
     std::vector<VkVertexInputAttributeDescription> vkVertexInputAttributeDescriptions;
     vkVertexInputAttributeDescriptions.reserve(pipelineCI.vertexInputState.attributes.size());
@@ -1047,38 +1838,97 @@ void *GraphicsAPI_Vulkan::CreatePipeline(const PipelineCreateInfo &pipelineCI) {
     GPCI.basePipelineHandle = VK_NULL_HANDLE;
     GPCI.basePipelineIndex = -1;
 
-    VULKAN_CHECK(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &GPCI, nullptr, &pipeline), "Failed to create Graphics Pipeline.");
-    pipelineResources[pipeline] = {pipelineLayout, descSetLayout, renderPass, pipelineCI};
+    VULKAN_CHECK(vkCreateGraphicsPipelines(device, pipelineCache, 1, &GPCI, nullptr, &pipeline), "Failed to create Graphics Pipeline.");
+    const PipelineResource pipelineResource = {pipeline, pipelineLayout, descSetLayouts, renderPass, pipelineCI, keys};
+    sharedPipelines[keys.pipeline] = {pipelineResource, 1};
 
-    return (void *)pipeline;
+    return pipelineResources.Insert(pipelineResource);
 }
 
-void GraphicsAPI_Vulkan::DestroyPipeline(void *&pipeline) {
-    VkPipeline vkPipeline = (VkPipeline)pipeline;
-    VkPipelineLayout pipelineLayout = std::get<0>(pipelineResources[vkPipeline]);
-    VkDescriptorSetLayout descSetLayout = std::get<1>(pipelineResources[vkPipeline]);
-    VkRenderPass renderPass = std::get<2>(pipelineResources[vkPipeline]);
-    vkDestroyRenderPass(device, renderPass, nullptr);
-    vkDestroyDescriptorSetLayout(device, descSetLayout, nullptr);
-    vkDestroyPipeline(device, vkPipeline, nullptr);
-    pipelineResources.erase(vkPipeline);
-    pipeline = nullptr;
+void GraphicsAPI_Vulkan::DestroyPipeline(PipelineHandle &pipeline) {
+    const PipelineResource pipelineResource = pipelineResources[pipeline];
+    pipelineResources.Erase(pipeline);
+    pipeline = PipelineHandle();
+
+    // Only destroy the pipeline, and the objects it was built from, when their last reference is released.
+    const PipelineKeys &keys = pipelineResource.keys;
+    if (!ReleaseSharedObject(sharedPipelines, keys.pipeline)) {
+        return;
+    }
+    VkPipelineLayout pipelineLayout = pipelineResource.pipelineLayout;
+    const std::vector<VkDescriptorSetLayout> &descSetLayouts = pipelineResource.descSetLayouts;
+    VkRenderPass renderPass = pipelineResource.renderPass;
+    // Command buffers that are still in flight may use the pipeline and the objects it was built from, so they're all deferred.
+    DeferredDestroys &deferredDestroys = GetDeferredDestroys();
+    deferredDestroys.pipelines.push_back(pipelineResource.pipeline);
+
+    if (ReleaseSharedObject(sharedPipelineLayouts, keys.pipelineLayout)) {
+        deferredDestroys.pipelineLayouts.push_back(pipelineLayout);
+    }
+    for (size_t set = 0; set < descSetLayouts.size(); set++) {
+        VkDescriptorSetLayout descSetLayout = descSetLayouts[set];
+        if (ReleaseSharedObject(sharedDescSetLayouts, keys.descSetLayouts[set])) {
+            InvalidateDescriptorSetCaches();
+            if (descSetLayoutUpdateTemplates[descSetLayout]) {
+                deferredDestroys.descUpdateTemplates.push_back(descSetLayoutUpdateTemplates[descSetLayout]);
+            }
+            descSetLayoutUpdateTemplates.erase(descSetLayout);
+            deferredDestroys.descSetLayouts.push_back(descSetLayout);
+        }
+    }
+    if (ReleaseSharedObject(sharedRenderPasses, keys.renderPass)) {
+        InvalidateFramebuffers(renderPass, VK_NULL_HANDLE);
+        for (auto it = renderPassVariants.begin(); it != renderPassVariants.end();) {
+            if (std::get<0>(it->first) == renderPass) {
+                deferredDestroys.renderPasses.push_back(it->second);
+                it = renderPassVariants.erase(it);
+            } else {
+                it++;
+            }
+        }
+        deferredDestroys.renderPasses.push_back(renderPass);
+    }
 }
 
-void GraphicsAPI_Vulkan::BeginRendering() {
-    VULKAN_CHECK(vkWaitForFences(device, 1, &fence, true, UINT64_MAX), "Failed to wait for Fence");
-    VULKAN_CHECK(vkResetFences(device, 1, &fence), "Failed to reset Fence.")
+void GraphicsAPI_Vulkan::BeginFrame() {
+    BeginCommandBuffer();
+    inFrame = true;
+}
 
-    // VULKAN_CHECK(vkResetDescriptorPool(device, descriptorPool, VkDescriptorPoolResetFlags(0)), "Failed to rest DescriptorPool")
-    for (const auto &descSet : cmdBufferDescriptorSets[cmdBuffer]) {
-        VULKAN_CHECK(vkFreeDescriptorSets(device, descriptorPool, 1, &descSet), "Failed to free DescriptorSet.");
+void GraphicsAPI_Vulkan::EndFrame() {
+    if (inRenderPass) {
+        vkCmdEndRenderPass(cmdBuffer);
+        inRenderPass = false;
     }
-    cmdBufferDescriptorSets.erase(cmdBuffer);
+    SubmitCommandBuffer();
+    inFrame = false;
+}
 
-    for (const VkFramebuffer &framebuffer : cmdBufferFramebuffers[cmdBuffer]) {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
+void GraphicsAPI_Vulkan::BeginCommandBuffer() {
+    // Move on to the next frame context. Only wait for the GPU to finish the work that was last submitted with it.
+    frameContextIndex = (frameContextIndex + 1) % static_cast<uint32_t>(frameContexts.size());
+    FrameContext &frameContext = frameContexts[frameContextIndex];
+    cmdBuffer = frameContext.cmdBuffer;
+    boundPipelineLayout = VK_NULL_HANDLE;  // Nothing is bound in a new command buffer.
+
+    VULKAN_CHECK(vkWaitForFences(device, 1, &frameContext.fence, true, UINT64_MAX), "Failed to wait for Fence");
+    VULKAN_CHECK(vkResetFences(device, 1, &frameContext.fence), "Failed to reset Fence.")
+
+    // The GPU is done with this frame context, so its transient uniform data can be overwritten.
+    frameContext.uniformBufferRing.bufferIndex = 0;
+    frameContext.uniformBufferRing.offset = 0;
+
+    // Descriptor sets are cached across frames. Only drop them when a resource was destroyed or the cache outgrew a single pool.
+    if (frameContext.resetDescriptorSetCache || frameContext.descriptorPoolIndex > 0) {
+        for (const VkDescriptorPool &descriptorPool : frameContext.descriptorPools) {
+            VULKAN_CHECK(vkResetDescriptorPool(device, descriptorPool, VkDescriptorPoolResetFlags(0)), "Failed to reset DescriptorPool.")
+        }
+        frameContext.descriptorPoolIndex = 0;
+        frameContext.descriptorSetCache.clear();
+        frameContext.resetDescriptorSetCache = false;
     }
-    cmdBufferFramebuffers.erase(cmdBuffer);
+
+    DestroyDeferredObjects(frameContext.deferredDestroys);
 
     VULKAN_CHECK(vkResetCommandBuffer(cmdBuffer, VkCommandBufferResetFlagBits(0)), "Failed to reset CommandBuffer.");
 
@@ -1088,6 +1938,34 @@ void GraphicsAPI_Vulkan::BeginRendering() {
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     beginInfo.pInheritanceInfo = nullptr;
     VULKAN_CHECK(vkBeginCommandBuffer(cmdBuffer, &beginInfo), "Failed to begin CommandBuffer.");
+    cmdBufferRecording = true;
+}
+
+void GraphicsAPI_Vulkan::SubmitCommandBuffer() {
+    VULKAN_CHECK(vkEndCommandBuffer(cmdBuffer), "Failed to end CommandBuffer.");
+
+    VkPipelineStageFlags waitDstStageMask = VkPipelineStageFlagBits::VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = nullptr;
+    submitInfo.waitSemaphoreCount = acquireSemaphore ? 1 : 0;
+    submitInfo.pWaitSemaphores = acquireSemaphore ? &acquireSemaphore : nullptr;
+    submitInfo.pWaitDstStageMask = acquireSemaphore ? &waitDstStageMask : nullptr;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmdBuffer;
+    submitInfo.signalSemaphoreCount = submitSemaphore ? 1 : 0;
+    submitInfo.pSignalSemaphores = submitSemaphore ? &submitSemaphore : nullptr;
+
+    VULKAN_CHECK(vkQueueSubmit(queue, 1, &submitInfo, frameContexts[frameContextIndex].fence), "Failed to submit to Queue.");
+    cmdBufferRecording = false;
+}
+
+void GraphicsAPI_Vulkan::BeginRendering() {
+    // Outside of BeginFrame()/EndFrame(), every BeginRendering()/EndRendering() pair is recorded and submitted on its own.
+    if (!inFrame) {
+        BeginCommandBuffer();
+    }
 
     if (currentDesktopSwapchainImage) {
         VkImageMemoryBarrier barrier;
@@ -1095,8 +1973,8 @@ void GraphicsAPI_Vulkan::BeginRendering() {
         barrier.pNext = nullptr;
         barrier.srcAccessMask = VkAccessFlagBits(0);
         barrier.dstAccessMask = VkAccessFlagBits::VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VkAccessFlagBits::VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-        barrier.oldLayout = imageStates[currentDesktopSwapchainImage];
-        barrier.newLayout = imageStates[currentDesktopSwapchainImage] = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        barrier.oldLayout = currentDesktopSwapchainImageLayout;
+        barrier.newLayout = currentDesktopSwapchainImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
         barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.image = currentDesktopSwapchainImage;
@@ -1113,6 +1991,7 @@ void GraphicsAPI_Vulkan::EndRendering() {
         vkCmdEndRenderPass(cmdBuffer);
         inRenderPass = false;
     }
+    FlushPendingClears();
 
     if (currentDesktopSwapchainImage) {
         VkImageMemoryBarrier barrier;
@@ -1120,8 +1999,8 @@ void GraphicsAPI_Vulkan::EndRendering() {
         barrier.pNext = nullptr;
         barrier.srcAccessMask = VkAccessFlagBits::VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
         barrier.dstAccessMask = VkAccessFlagBits(0);
-        barrier.oldLayout = imageStates[currentDesktopSwapchainImage];
-        barrier.newLayout = imageStates[currentDesktopSwapchainImage] = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        barrier.oldLayout = currentDesktopSwapchainImageLayout;
+        barrier.newLayout = currentDesktopSwapchainImageLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
         barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.image = currentDesktopSwapchainImage;
@@ -1132,45 +2011,112 @@ void GraphicsAPI_Vulkan::EndRendering() {
                              1, &barrier);
     }
 
-    VULKAN_CHECK(vkEndCommandBuffer(cmdBuffer), "Failed to end CommandBuffer.");
-
-    VkPipelineStageFlags waitDstStageMask = VkPipelineStageFlagBits::VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-
-    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.pNext = nullptr;
-    submitInfo.waitSemaphoreCount = acquireSemaphore ? 1 : 0;
-    submitInfo.pWaitSemaphores = acquireSemaphore ? &acquireSemaphore : nullptr;
-    submitInfo.pWaitDstStageMask = acquireSemaphore ? &waitDstStageMask : nullptr;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &cmdBuffer;
-    submitInfo.signalSemaphoreCount = submitSemaphore ? 1 : 0;
-    submitInfo.pSignalSemaphores = submitSemaphore ? &submitSemaphore : nullptr;
-
-    VULKAN_CHECK(vkQueueSubmit(queue, 1, &submitInfo, fence), "Failed to submit to Queue.");
+    if (!inFrame) {
+        SubmitCommandBuffer();
+    }
 }
 
-void GraphicsAPI_Vulkan::SetBufferData(void *buffer, size_t offset, size_t size, void *data) {
-    VkBuffer vkBuffer = (VkBuffer)buffer;
-    VkDeviceMemory memory = bufferResources[vkBuffer].first;
-    void *mappedData = nullptr;
-    VULKAN_CHECK(vkMapMemory(device, memory, offset, size, 0, &mappedData), "Can not map Buffer.");
+void GraphicsAPI_Vulkan::SetBufferData(BufferHandle buffer, size_t offset, size_t size, void *data) {
+    const BufferResource &bufferResource = bufferResources[buffer];
+    VkBuffer vkBuffer = bufferResource.buffer;
+    uint8_t *mappedData = (uint8_t *)bufferResource.allocation.mappedData;
     if (mappedData && data) {
-        memcpy(mappedData, data, size);
+        memcpy(mappedData + offset, data, size);
         // Because the VkDeviceMemory use a heap with properties (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
         // We don't need to use vkFlushMappedMemoryRanges() or vkInvalidateMappedMemoryRanges()
+    } else if (data) {
+        // The buffer is in DEVICE_LOCAL memory that the CPU can't access. The upload is submitted on its own, so it would overtake the
+        // draws that are being recorded, and those may read the old contents. Update STATIC buffers between frames instead.
+        if (cmdBufferRecording) {
+            std::cout << "ERROR: VULKAN: Can not update a STATIC Buffer while a frame is being recorded." << std::endl;
+            DEBUG_BREAK;
+            return;
+        }
+        // Wait until the device is done with it, and upload through a staging buffer on the graphics queue, which already owns it.
+        VULKAN_CHECK(vkQueueWaitIdle(queue), "Failed to wait for Queue.");
+        UploadBufferData(vkBuffer, offset, size, data, false);
     }
-    vkUnmapMemory(device, memory);
 };
 
+GraphicsAPI::BufferHandle GraphicsAPI_Vulkan::AllocateUniformBufferData(size_t size, void *data, size_t &offset) {
+    const size_t alignedSize = AlignSizeForUniformBuffer(size);
+
+    // Move on to the next buffer in the ring, if the current one can't fit the allocation.
+    UniformBufferRing &ring = frameContexts[frameContextIndex].uniformBufferRing;
+    while (ring.bufferIndex < ring.buffers.size() && ring.offset + alignedSize > bufferResources[ring.buffers[ring.bufferIndex]].bufferCI.size) {
+        ring.bufferIndex++;
+        ring.offset = 0;
+    }
+    if (ring.bufferIndex == ring.buffers.size()) {
+        // The ring's buffers are all released together, so they can be allocated linearly.
+        ring.buffers.push_back(CreateBuffer({BufferCreateInfo::Type::UNIFORM, 0, std::max(alignedSize, size_t(uniformBufferRingBlockSize)), nullptr, BufferCreateInfo::Usage::STREAM}, MemoryStrategy::LINEAR));
+    }
+
+    BufferHandle buffer = ring.buffers[ring.bufferIndex];
+    offset = ring.offset;
+    SetBufferData(buffer, offset, size, data);
+    ring.offset += alignedSize;
+
+    return buffer;
+}
+
 void GraphicsAPI_Vulkan::ClearColor(void *imageView, float r, float g, float b, float a) {
-    const ImageViewCreateInfo &imageViewCI = imageViewResources[(VkImageView)imageView];
+    VkClearValue clearValue;
+    clearValue.color.float32[0] = r;
+    clearValue.color.float32[1] = g;
+    clearValue.color.float32[2] = b;
+    clearValue.color.float32[3] = a;
+    ClearAttachment((VkImageView)imageView, VK_IMAGE_ASPECT_COLOR_BIT, clearValue);
+}
 
-    VkClearColorValue clearColor;
-    clearColor.float32[0] = r;
-    clearColor.float32[1] = g;
-    clearColor.float32[2] = b;
-    clearColor.float32[3] = a;
+void GraphicsAPI_Vulkan::ClearDepth(void *imageView, float d) {
+    VkClearValue clearValue;
+    clearValue.depthStencil.depth = d;
+    clearValue.depthStencil.stencil = 0;
+    ClearAttachment((VkImageView)imageView, VK_IMAGE_ASPECT_DEPTH_BIT, clearValue);
+}
+
+void GraphicsAPI_Vulkan::ClearAttachment(VkImageView imageView, VkImageAspectFlags aspectMask, const VkClearValue &clearValue) {
+    // Inside a render pass, clear the attachment directly.
+    auto attachment = std::find(renderPassAttachments.begin(), renderPassAttachments.end(), imageView);
+    if (inRenderPass && attachment != renderPassAttachments.end()) {
+        VkClearAttachment clearAttachment;
+        clearAttachment.aspectMask = aspectMask;
+        clearAttachment.colorAttachment = static_cast<uint32_t>(attachment - renderPassAttachments.begin());
+        clearAttachment.clearValue = clearValue;
+
+        VkClearRect clearRect;
+        clearRect.rect = renderPassRenderArea;
+        clearRect.baseArrayLayer = 0;
+        clearRect.layerCount = 1;
+        vkCmdClearAttachments(cmdBuffer, 1, &clearAttachment, 1, &clearRect);
+        return;
+    }
+
+    // Otherwise, defer the clear to the next SetRenderAttachments() that uses the image view, where it becomes VK_ATTACHMENT_LOAD_OP_CLEAR.
+    for (PendingClear &pendingClear : pendingClears) {
+        if (pendingClear.imageView == imageView) {
+            pendingClear.clearValue = clearValue;
+            return;
+        }
+    }
+    pendingClears.push_back({imageView, aspectMask, clearValue});
+}
+
+void GraphicsAPI_Vulkan::FlushPendingClears() {
+    // Image views that were cleared, but never used as render attachments, are cleared with transfer commands.
+    for (const PendingClear &pendingClear : pendingClears) {
+        if (pendingClear.aspectMask & VK_IMAGE_ASPECT_DEPTH_BIT) {
+            ClearDepthImage(pendingClear.imageView, pendingClear.clearValue.depthStencil);
+        } else {
+            ClearColorImage(pendingClear.imageView, pendingClear.clearValue.color);
+        }
+    }
+    pendingClears.clear();
+}
+
+void GraphicsAPI_Vulkan::ClearColorImage(VkImageView imageView, const VkClearColorValue &clearColor) {
+    const ImageViewCreateInfo &imageViewCI = imageViewResources[imageView];
 
     VkImageSubresourceRange range;
     range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -1207,12 +2153,8 @@ void GraphicsAPI_Vulkan::ClearColor(void *imageView, float r, float g, float b,
     vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VkDependencyFlagBits(0), 0, nullptr, 0, nullptr, 1, &imageBarrier);
 }
 
-void GraphicsAPI_Vulkan::ClearDepth(void *imageView, float d) {
-    const ImageViewCreateInfo &imageViewCI = imageViewResources[(VkImageView)imageView];
-
-    VkClearDepthStencilValue clearDepth;
-    clearDepth.depth = d;
-    clearDepth.stencil = 0;
+void GraphicsAPI_Vulkan::ClearDepthImage(VkImageView imageView, const VkClearDepthStencilValue &clearDepth) {
+    const ImageViewCreateInfo &imageViewCI = imageViewResources[imageView];
 
     VkImageSubresourceRange range;
     range.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
@@ -1249,12 +2191,12 @@ void GraphicsAPI_Vulkan::ClearDepth(void *imageView, float d) {
     vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, VkDependencyFlagBits(0), 0, nullptr, 0, nullptr, 1, &imageBarrier);
 }
 
-void GraphicsAPI_Vulkan::SetRenderAttachments(void **colorViews, size_t colorViewCount, void *depthStencilView, uint32_t width, uint32_t height, void *pipeline) {
+void GraphicsAPI_Vulkan::SetRenderAttachments(void **colorViews, size_t colorViewCount, void *depthStencilView, uint32_t width, uint32_t height, PipelineHandle pipeline) {
     if (inRenderPass) {
         vkCmdEndRenderPass(cmdBuffer);
     }
 
-    VkRenderPass renderPass = std::get<2>(pipelineResources[(VkPipeline)pipeline]);
+    VkRenderPass renderPass = pipelineResources[pipeline].renderPass;
 
     std::vector<VkImageView> vkImageViews;
     for (size_t i = 0; i < colorViewCount; i++) {
@@ -1264,32 +2206,54 @@ void GraphicsAPI_Vulkan::SetRenderAttachments(void **colorViews, size_t colorVie
         vkImageViews.push_back((VkImageView)depthStencilView);
     }
 
+    // Fold any pending clears of these attachments into the render pass.
+    uint32_t clearAttachmentMask = 0;
+    std::vector<VkClearValue> clearValues(vkImageViews.size());
+    for (size_t i = 0; i < vkImageViews.size(); i++) {
+        for (auto it = pendingClears.begin(); it != pendingClears.end(); it++) {
+            if (it->imageView == vkImageViews[i]) {
+                clearAttachmentMask |= 1u << static_cast<uint32_t>(i);
+                clearValues[i] = it->clearValue;
+                pendingClears.erase(it);
+                break;
+            }
+        }
+    }
+
     VkFramebuffer framebuffer{};
-    VkFramebufferCreateInfo framebufferCI;
-    framebufferCI.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferCI.pNext = nullptr;
-    framebufferCI.flags = 0;
-    framebufferCI.renderPass = renderPass;
-    framebufferCI.attachmentCount = static_cast<uint32_t>(vkImageViews.size());
-    framebufferCI.pAttachments = vkImageViews.data();
-    framebufferCI.width = width;
-    framebufferCI.height = height;
-    framebufferCI.layers = 1;
-    VULKAN_CHECK(vkCreateFramebuffer(device, &framebufferCI, nullptr, &framebuffer), "Failed to create Framebuffer");
-    cmdBufferFramebuffers[cmdBuffer].push_back(framebuffer);
+    auto framebufferKey = std::make_tuple(renderPass, vkImageViews, width, height);
+    auto it = framebufferCache.find(framebufferKey);
+    if (it != framebufferCache.end()) {
+        framebuffer = it->second;
+    } else {
+        VkFramebufferCreateInfo framebufferCI;
+        framebufferCI.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferCI.pNext = nullptr;
+        framebufferCI.flags = 0;
+        framebufferCI.renderPass = renderPass;
+        framebufferCI.attachmentCount = static_cast<uint32_t>(vkImageViews.size());
+        framebufferCI.pAttachments = vkImageViews.data();
+        framebufferCI.width = width;
+        framebufferCI.height = height;
+        framebufferCI.layers = 1;
+        VULKAN_CHECK(vkCreateFramebuffer(device, &framebufferCI, nullptr, &framebuffer), "Failed to create Framebuffer");
+        framebufferCache[framebufferKey] = framebuffer;
+    }
 
     VkRenderPassBeginInfo renderPassBegin;
     renderPassBegin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassBegin.pNext = nullptr;
-    renderPassBegin.renderPass = renderPass;
+    renderPassBegin.renderPass = GetRenderPass(pipeline, clearAttachmentMask);
     renderPassBegin.framebuffer = framebuffer;
     renderPassBegin.renderArea.offset = {0, 0};
-    renderPassBegin.renderArea.extent.width = framebufferCI.width;
-    renderPassBegin.renderArea.extent.height = framebufferCI.height;
-    renderPassBegin.clearValueCount = 0;
-    renderPassBegin.pClearValues = nullptr;
+    renderPassBegin.renderArea.extent.width = width;
+    renderPassBegin.renderArea.extent.height = height;
+    renderPassBegin.clearValueCount = clearAttachmentMask ? static_cast<uint32_t>(clearValues.size()) : 0;
+    renderPassBegin.pClearValues = clearAttachmentMask ? clearValues.data() : nullptr;
     vkCmdBeginRenderPass(cmdBuffer, &renderPassBegin, VK_SUBPASS_CONTENTS_INLINE);
     inRenderPass = true;
+    renderPassAttachments = vkImageViews;
+    renderPassRenderArea = renderPassBegin.renderArea;
 }
 
 void GraphicsAPI_Vulkan::SetViewports(Viewport *viewports, size_t count) {
@@ -1312,40 +2276,28 @@ void GraphicsAPI_Vulkan::SetScissors(Rect2D *scissors, size_t count) {
 
     vkCmdSetScissor(cmdBuffer, 0, static_cast<uint32_t>(vkRect2D.size()), vkRect2D.data());
 }
-void GraphicsAPI_Vulkan::SetPipeline(void *pipeline) {
-    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, (VkPipeline)pipeline);
-    setPipeline = (VkPipeline)pipeline;
+void GraphicsAPI_Vulkan::SetPipeline(PipelineHandle pipeline) {
+    setPipeline = pipeline;
+    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineResources[setPipeline].pipeline);
 }
 
 void GraphicsAPI_Vulkan::SetDescriptor(const DescriptorInfo &descriptorInfo) {
-    VkWriteDescriptorSet writeDescSet;
-    writeDescSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writeDescSet.pNext = nullptr;
-    writeDescSet.dstSet = VK_NULL_HANDLE;
-    writeDescSet.dstBinding = descriptorInfo.bindingIndex;
-    writeDescSet.dstArrayElement = 0;
-    writeDescSet.descriptorCount = 1;
-    writeDescSet.descriptorType = ToVkDescrtiptorType(descriptorInfo);
-    writeDescSet.pImageInfo = nullptr;
-    writeDescSet.pBufferInfo = nullptr;
-    writeDescSet.pTexelBufferView = nullptr;
-    writeDescSets.push_back({writeDescSet, {}, {}});
+    DescriptorData data;
+    memset(&data, 0, sizeof(DescriptorData));
 
     if (descriptorInfo.type == DescriptorInfo::Type::BUFFER) {
-        VkDescriptorBufferInfo &descBufferInfo = std::get<1>(writeDescSets.back());
-        VkBuffer buffer = (VkBuffer)descriptorInfo.resource;
-        const BufferCreateInfo &bufferCI = bufferResources[buffer].second;
-        descBufferInfo.buffer = buffer;
+        VkDescriptorBufferInfo &descBufferInfo = data.bufferInfo;
+        descBufferInfo.buffer = bufferResources[BufferHandle::FromPointer(descriptorInfo.resource)].buffer;
         descBufferInfo.offset = descriptorInfo.bufferOffset;
         descBufferInfo.range = descriptorInfo.bufferSize;
     } else if (descriptorInfo.type == DescriptorInfo::Type::IMAGE) {
-        VkDescriptorImageInfo &descImageInfo = std::get<2>(writeDescSets.back());
+        VkDescriptorImageInfo &descImageInfo = data.imageInfo;
         VkImageView imageView = (VkImageView)descriptorInfo.resource;
         descImageInfo.sampler = VK_NULL_HANDLE;
         descImageInfo.imageView = imageView;
         descImageInfo.imageLayout = descriptorInfo.readWrite ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     } else if (descriptorInfo.type == DescriptorInfo::Type::SAMPLER) {
-        VkDescriptorImageInfo &descImageInfo = std::get<2>(writeDescSets.back());
+        VkDescriptorImageInfo &descImageInfo = data.imageInfo;
         VkSampler sampler = (VkSampler)descriptorInfo.resource;
         descImageInfo.sampler = sampler;
         descImageInfo.imageView = VK_NULL_HANDLE;
@@ -1355,60 +2307,135 @@ void GraphicsAPI_Vulkan::SetDescriptor(const DescriptorInfo &descriptorInfo) {
         DEBUG_BREAK;
         return;
     }
+    auto it = std::find_if(currentDescriptors.begin(), currentDescriptors.end(), [&](const CurrentDescriptor &currentDescriptor) {
+        return currentDescriptor.set == descriptorInfo.set && currentDescriptor.bindingIndex == descriptorInfo.bindingIndex;
+    });
+    if (it != currentDescriptors.end()) {
+        it->data = data;
+    } else {
+        currentDescriptors.push_back({descriptorInfo.set, descriptorInfo.bindingIndex, data});
+    }
+    dirtySets |= 1u << descriptorInfo.set;
 }
 
 void GraphicsAPI_Vulkan::UpdateDescriptors() {
-    VkPipelineLayout pipelineLayout = std::get<0>(pipelineResources[(VkPipeline)setPipeline]);
-    VkDescriptorSetLayout descSetLayout = std::get<1>(pipelineResources[(VkPipeline)setPipeline]);
-    PipelineCreateInfo pipelinCI = std::get<3>(pipelineResources[(VkPipeline)setPipeline]);
+    const PipelineResource &pipelineResource = pipelineResources[setPipeline];
+    VkPipelineLayout pipelineLayout = pipelineResource.pipelineLayout;
+    const std::vector<VkDescriptorSetLayout> &descSetLayouts = pipelineResource.descSetLayouts;
+    const PipelineCreateInfo &pipelineCI = pipelineResource.pipelineCI;
+
+    // Sets bound with a different pipeline layout may be disturbed, so they're all bound again with the descriptors set last.
+    if (pipelineLayout != boundPipelineLayout) {
+        boundPipelineLayout = pipelineLayout;
+        dirtySets = ~0u;
+    }
 
-    VkDescriptorSet descSet{};
-    VkDescriptorSetAllocateInfo descSetAI;
-    descSetAI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    descSetAI.pNext = nullptr;
-    descSetAI.descriptorPool = descriptorPool;
-    descSetAI.descriptorSetCount = 1;
-    descSetAI.pSetLayouts = &descSetLayout;
-    VULKAN_CHECK(vkAllocateDescriptorSets(device, &descSetAI, &descSet), "Failed to allocate DescriptorSet.");
-
-    std::vector<VkWriteDescriptorSet> vkWriteDescSets;
-    for (auto &writeDescSet : writeDescSets) {
-        VkWriteDescriptorSet &vkWriteDescSet = std::get<0>(writeDescSet);
-        VkDescriptorBufferInfo &vkDescBufferInfo = std::get<1>(writeDescSet);
-        VkDescriptorImageInfo &vkDescImageInfo = std::get<2>(writeDescSet);
-
-        vkWriteDescSet.dstSet = descSet;
-        if (vkDescBufferInfo.buffer) {
-            vkWriteDescSet.pBufferInfo = &vkDescBufferInfo;
-        } else if (vkDescImageInfo.imageView || vkDescImageInfo.sampler) {
-            vkWriteDescSet.pImageInfo = &vkDescImageInfo;
-        } else {
+    // Only the dirty sets are updated and bound. The others stay bound, so descriptors that change per draw
+    // don't cause the ones that change per frame to be rebound.
+    FrameContext &frameContext = frameContexts[frameContextIndex];
+    for (uint32_t set = 0; set < static_cast<uint32_t>(descSetLayouts.size()); set++) {
+        if ((dirtySets & (1u << set)) == 0) {
+            continue;
+        }
+        VkDescriptorSetLayout descSetLayout = descSetLayouts[set];
+
+        // Gather the current descriptors in the order of the set's layout. Zero the data first, so that the padding bytes in the key are deterministic.
+        descriptorData.clear();
+        bool complete = true;
+        bool any = false;
+        for (const DescriptorInfo &descInfo : pipelineCI.layout) {
+            if (descInfo.set != set) {
+                continue;
+            }
+            DescriptorData data;
+            memset(&data, 0, sizeof(DescriptorData));
+            bool found = false;
+            for (const CurrentDescriptor &currentDescriptor : currentDescriptors) {
+                if (currentDescriptor.set == set && currentDescriptor.bindingIndex == descInfo.bindingIndex) {
+                    data = currentDescriptor.data;
+                    found = true;
+                }
+            }
+            descriptorData.push_back(data);
+            complete &= found;
+            any |= found;
+        }
+        if (!any) {
             continue;
         }
-        vkWriteDescSets.push_back(vkWriteDescSet);
+
+        descriptorSetKey.assign(reinterpret_cast<const char *>(&descSetLayout), sizeof(VkDescriptorSetLayout));
+        descriptorSetKey.append(reinterpret_cast<const char *>(descriptorData.data()), descriptorData.size() * sizeof(DescriptorData));
+
+        VkDescriptorSet descSet{};
+        auto it = frameContext.descriptorSetCache.find(descriptorSetKey);
+        if (it != frameContext.descriptorSetCache.end()) {
+            descSet = it->second;
+        } else {
+            descSet = AllocateDescriptorSet(descSetLayout);
+
+            VkDescriptorUpdateTemplateKHR updateTemplate = descSetLayoutUpdateTemplates[descSetLayout];
+            if (updateTemplate && complete) {
+                vkUpdateDescriptorSetWithTemplateKHR(device, descSet, updateTemplate, descriptorData.data());
+            } else {
+                // No template or some bindings weren't set: only write the descriptors that we have.
+                std::vector<VkWriteDescriptorSet> vkWriteDescSets;
+                size_t i = 0;
+                for (const DescriptorInfo &descInfo : pipelineCI.layout) {
+                    if (descInfo.set != set) {
+                        continue;
+                    }
+                    const DescriptorData &data = descriptorData[i++];
+                    VkWriteDescriptorSet writeDescSet;
+                    writeDescSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                    writeDescSet.pNext = nullptr;
+                    writeDescSet.dstSet = descSet;
+                    writeDescSet.dstBinding = descInfo.bindingIndex;
+                    writeDescSet.dstArrayElement = 0;
+                    writeDescSet.descriptorCount = 1;
+                    writeDescSet.descriptorType = ToVkDescrtiptorType(descInfo);
+                    writeDescSet.pImageInfo = nullptr;
+                    writeDescSet.pBufferInfo = nullptr;
+                    writeDescSet.pTexelBufferView = nullptr;
+                    if (data.bufferInfo.buffer) {
+                        writeDescSet.pBufferInfo = &data.bufferInfo;
+                    } else if (data.imageInfo.imageView || data.imageInfo.sampler) {
+                        writeDescSet.pImageInfo = &data.imageInfo;
+                    } else {
+                        continue;
+                    }
+                    vkWriteDescSets.push_back(writeDescSet);
+                }
+                vkUpdateDescriptorSets(device, static_cast<uint32_t>(vkWriteDescSets.size()), vkWriteDescSets.data(), 0, nullptr);
+            }
+            frameContext.descriptorSetCache[descriptorSetKey] = descSet;
+        }
+
+        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, set, 1, &descSet, 0, nullptr);
     }
-    vkUpdateDescriptorSets(device, static_cast<uint32_t>(vkWriteDescSets.size()), vkWriteDescSets.data(), 0, nullptr);
-    writeDescSets.clear();
+    dirtySets = 0;
+}
 
-    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descSet, 0, nullptr);
-    cmdBufferDescriptorSets[cmdBuffer].push_back({descSet});
+void GraphicsAPI_Vulkan::SetPushConstants(DescriptorInfo::Stage stage, uint32_t offset, uint32_t size, const void *data) {
+    VkPipelineLayout pipelineLayout = pipelineResources[setPipeline].pipelineLayout;
+    vkCmdPushConstants(cmdBuffer, pipelineLayout, static_cast<VkShaderStageFlags>(1 << (uint32_t)stage), offset, size, data);
 }
 
-void GraphicsAPI_Vulkan::SetVertexBuffers(void **vertexBuffers, size_t count) {
+void GraphicsAPI_Vulkan::SetVertexBuffers(BufferHandle *vertexBuffers, size_t count) {
     std::vector<VkBuffer> vkBuffers;
     std::vector<VkDeviceSize> offsets;
     for (size_t i = 0; i < count; i++) {
-        vkBuffers.push_back((VkBuffer)vertexBuffers[i]);
+        vkBuffers.push_back(bufferResources[vertexBuffers[i]].buffer);
         offsets.push_back(0);
     }
 
     vkCmdBindVertexBuffers(cmdBuffer, 0, static_cast<uint32_t>(vkBuffers.size()), vkBuffers.data(), offsets.data());
 }
 
-void GraphicsAPI_Vulkan::SetIndexBuffer(void *indexBuffer) {
-    const BufferCreateInfo &bufferCI = bufferResources[(VkBuffer)indexBuffer].second;
-    VkIndexType type = bufferCI.stride == 4 ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
-    vkCmdBindIndexBuffer(cmdBuffer, (VkBuffer)indexBuffer, 0, type);
+void GraphicsAPI_Vulkan::SetIndexBuffer(BufferHandle indexBuffer) {
+    const BufferResource &bufferResource = bufferResources[indexBuffer];
+    VkIndexType type = bufferResource.bufferCI.stride == 4 ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+    vkCmdBindIndexBuffer(cmdBuffer, bufferResource.buffer, 0, type);
 }
 
 void GraphicsAPI_Vulkan::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) {
@@ -7,11 +7,16 @@
 #pragma once
 #include <GraphicsAPI.h>
 
+#include <map>
+
 #if defined(XR_USE_GRAPHICS_API_VULKAN)
-class GraphicsAPI_Vulkan : public GraphicsAPI {
+class GraphicsAPI_Vulkan final : public GraphicsAPI {
 public:
-    GraphicsAPI_Vulkan();
-    GraphicsAPI_Vulkan(XrInstance m_xrInstance, XrSystemId systemId);
+    // With more than one frame in flight, the CPU records the next frame while the GPU still reads the data of earlier ones.
+    // Per-frame data must then be written to separate storage for each of them, e.g. with AllocateUniformBufferData(). Pass 1 for
+    // applications that rewrite the same buffer with SetBufferData() every frame.
+    GraphicsAPI_Vulkan(uint32_t framesInFlight = 2);
+    GraphicsAPI_Vulkan(XrInstance m_xrInstance, XrSystemId systemId, uint32_t framesInFlight = 2);
     ~GraphicsAPI_Vulkan();
 
     virtual void* CreateDesktopSwapchain(const SwapchainCreateInfo& swapchainCI) override;
@@ -23,6 +28,7 @@ public:
     // XR_DOCS_TAG_BEGIN_GetDepthFormat_Vulkan
     virtual int64_t GetDepthFormat() override { return (int64_t)VK_FORMAT_D32_SFLOAT; }
     // XR_DOCS_TAG_END_GetDepthFormat_Vulkan
+    virtual size_t AlignSizeForUniformBuffer(size_t size) override { return Align<size_t>(size, static_cast<size_t>(physicalDeviceProperties.limits.minUniformBufferOffsetAlignment)); }
 
     virtual void* GetGraphicsBinding() override;
     virtual XrSwapchainImageBaseHeader* AllocateSwapchainImageData(XrSwapchain swapchain, SwapchainType type, uint32_t count) override;
@@ -34,8 +40,6 @@ public:
     // XR_DOCS_TAG_BEGIN_GetSwapchainImage_Vulkan
     virtual void* GetSwapchainImage(XrSwapchain swapchain, uint32_t index) override {
         VkImage image = swapchainImagesMap[swapchain].second[index].image;
-        VkImageLayout layout = swapchainImagesMap[swapchain].first == SwapchainType::COLOR ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-        imageStates[image] = layout;
         return (void *)image;
     }
     // XR_DOCS_TAG_END_GetSwapchainImage_Vulkan
@@ -49,32 +53,56 @@ public:
     virtual void* CreateSampler(const SamplerCreateInfo& samplerCI) override;
     virtual void DestroySampler(void*& sampler) override;
 
-    virtual void* CreateBuffer(const BufferCreateInfo& bufferCI) override;
-    virtual void DestroyBuffer(void*& buffer) override;
+    virtual BufferHandle CreateBuffer(const BufferCreateInfo& bufferCI) override;
+    virtual void DestroyBuffer(BufferHandle& buffer) override;
 
     virtual void* CreateShader(const ShaderCreateInfo& shaderCI) override;
     virtual void DestroyShader(void*& shader) override;
 
-    virtual void* CreatePipeline(const PipelineCreateInfo& pipelineCI) override;
-    virtual void DestroyPipeline(void*& pipeline) override;
+    virtual PipelineHandle CreatePipeline(const PipelineCreateInfo& pipelineCI) override;
+    virtual void DestroyPipeline(PipelineHandle& pipeline) override;
+
+    // Sets the number of frames the CPU can record ahead of the GPU. Waits for the device to be idle.
+    void SetFramesInFlight(uint32_t framesInFlight);
+    // Writes the pipeline cache to disk. This is also done in the destructor.
+    void SavePipelineCache();
+
+    // Sub-allocation statistics for one memory type. The free space is fragmented when largestFreeRange is much smaller than freeSize.
+    struct MemoryStats {
+        uint32_t memoryTypeIndex;
+        uint32_t blockCount;
+        uint32_t allocationCount;
+        VkDeviceSize blockSize;
+        VkDeviceSize usedSize;
+        VkDeviceSize freeSize;
+        uint32_t freeRangeCount;
+        VkDeviceSize largestFreeRange;
+    };
+    std::vector<MemoryStats> GetMemoryStats() const;
+
+    virtual void BeginFrame() override;
+    virtual void EndFrame() override;
 
     virtual void BeginRendering() override;
     virtual void EndRendering() override;
 
-    virtual void SetBufferData(void* buffer, size_t offset, size_t size, void* data) override;
+    virtual void SetBufferData(BufferHandle buffer, size_t offset, size_t size, void* data) override;
+    virtual BufferHandle AllocateUniformBufferData(size_t size, void* data, size_t& offset) override;
 
     virtual void ClearColor(void* imageView, float r, float g, float b, float a) override;
     virtual void ClearDepth(void* imageView, float d) override;
+    virtual void SetStoreDepthAttachment(bool store) override { storeDepthAttachment = store; }
 
-    virtual void SetRenderAttachments(void** colorViews, size_t colorViewCount, void* depthStencilView, uint32_t width, uint32_t height, void* pipeline) override;
+    virtual void SetRenderAttachments(void** colorViews, size_t colorViewCount, void* depthStencilView, uint32_t width, uint32_t height, PipelineHandle pipeline) override;
     virtual void SetViewports(Viewport* viewports, size_t count) override;
     virtual void SetScissors(Rect2D* scissors, size_t count) override;
 
-    virtual void SetPipeline(void* pipeline) override;
+    virtual void SetPipeline(PipelineHandle pipeline) override;
     virtual void SetDescriptor(const DescriptorInfo& descriptorInfo) override;
     virtual void UpdateDescriptors() override;
-    virtual void SetVertexBuffers(void** vertexBuffers, size_t count) override;
-    virtual void SetIndexBuffer(void* indexBuffer) override;
+    virtual void SetPushConstants(DescriptorInfo::Stage stage, uint32_t offset, uint32_t size, const void* data) override;
+    virtual void SetVertexBuffers(BufferHandle* vertexBuffers, size_t count) override;
+    virtual void SetIndexBuffer(BufferHandle indexBuffer) override;
     virtual void DrawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t firstInstance = 0) override;
     virtual void Draw(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0) override;
 
@@ -83,21 +111,72 @@ private:
     std::vector<std::string> GetInstanceExtensionsForOpenXR(XrInstance m_xrInstance, XrSystemId systemId);
     std::vector<std::string> GetDeviceExtensionsForOpenXR(XrInstance m_xrInstance, XrSystemId systemId);
 
+    void CreatePipelineCache();
+    void CreateFrameContexts(uint32_t framesInFlight);
+    void DestroyFrameContexts();
+    void BeginCommandBuffer();
+    void SubmitCommandBuffer();
+
+    enum class MemoryStrategy : uint8_t;
+    struct MemoryAllocation;
+    struct MemoryBlock;
+    MemoryAllocation AllocateMemory(const VkMemoryRequirements& memoryRequirements, VkMemoryPropertyFlags properties, MemoryStrategy strategy, bool image);
+    bool SubAllocateMemory(MemoryBlock& memoryBlock, VkDeviceSize size, VkDeviceSize alignment, MemoryAllocation& allocation);
+    void FreeMemory(const MemoryAllocation& allocation);
+    void DestroyMemoryBlock(MemoryBlock& memoryBlock);
+    BufferHandle CreateBuffer(const BufferCreateInfo& bufferCI, MemoryStrategy memoryStrategy);
+
+    void CreateUploadContext();
+    void DestroyUploadContext();
+    VkCommandBuffer BeginUploadCommandBuffer(VkCommandPool cmdPool);
+    void SubmitUploadCommandBuffer(VkQueue uploadQueue, VkCommandPool cmdPool, VkCommandBuffer uploadCmdBuffer);
+    void UploadBufferData(VkBuffer buffer, size_t offset, size_t size, const void* data, bool useTransferQueue);
+
+    VkDescriptorPool CreateDescriptorPool();
+    VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout descSetLayout);
+    void InvalidateDescriptorSetCaches();
+    void InvalidateFramebuffers(VkRenderPass renderPass, VkImageView imageView);
+    struct DeferredDestroys;
+    DeferredDestroys& GetDeferredDestroys();
+    void DestroyDeferredObjects(DeferredDestroys& deferredDestroys);
+
+    VkRenderPass CreateRenderPass(const PipelineCreateInfo& pipelineCI, uint32_t clearAttachmentMask, bool storeDepth);
+    VkRenderPass GetRenderPass(PipelineHandle pipeline, uint32_t clearAttachmentMask);
+    VkDescriptorSetLayout CreateDescriptorSetLayout(const std::vector<DescriptorInfo>& layout);
+    static uint32_t GetDescriptorSetCount(const std::vector<DescriptorInfo>& layout);
+    struct PipelineKeys;
+    PipelineKeys GetPipelineKeys(const PipelineCreateInfo& pipelineCI);
+
+    void ClearAttachment(VkImageView imageView, VkImageAspectFlags aspectMask, const VkClearValue& clearValue);
+    void FlushPendingClears();
+    void ClearColorImage(VkImageView imageView, const VkClearColorValue& clearColor);
+    void ClearDepthImage(VkImageView imageView, const VkClearDepthStencilValue& clearDepth);
+
     virtual const std::vector<int64_t> GetSupportedColorSwapchainFormats() override;
     virtual const std::vector<int64_t> GetSupportedDepthSwapchainFormats() override;
 
 private:
     VkInstance instance{};
     VkPhysicalDevice physicalDevice{};
+    VkPhysicalDeviceProperties physicalDeviceProperties{};
+    VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties{};
     VkDevice device{};
     uint32_t queueFamilyIndex = 0xFFFFFFFF;
     uint32_t queueIndex = 0xFFFFFFFF;
     VkQueue queue{};
-    VkFence fence{};
 
-    VkCommandPool cmdPool{};
+    // Staging uploads into DEVICE_LOCAL buffers. They use a dedicated transfer queue, if the device has one.
+    uint32_t transferQueueFamilyIndex = 0xFFFFFFFF;
+    VkQueue transferQueue{};
+    VkCommandPool uploadCmdPool{};
+    VkCommandPool transferCmdPool{};
+    VkFence uploadFence{};
+
+    VkPipelineCache pipelineCache{};
+    std::string pipelineCacheFilepath = "GraphicsAPI_Vulkan_PipelineCache.bin";
+
+    // The command buffer of the current frame context.
     VkCommandBuffer cmdBuffer{};
-    VkDescriptorPool descriptorPool;
 
     std::vector<const char*> activeInstanceLayers{};
     std::vector<const char*> activeInstanceExtensions{};
@@ -108,31 +187,169 @@ private:
     PFN_xrGetVulkanInstanceExtensionsKHR xrGetVulkanInstanceExtensionsKHR = nullptr;
     PFN_xrGetVulkanDeviceExtensionsKHR xrGetVulkanDeviceExtensionsKHR = nullptr;
     PFN_xrGetVulkanGraphicsDeviceKHR xrGetVulkanGraphicsDeviceKHR = nullptr;
+
+    // VK_KHR_descriptor_update_template. These are nullptr, if the device doesn't support the extension.
+    PFN_vkCreateDescriptorUpdateTemplateKHR vkCreateDescriptorUpdateTemplateKHR = nullptr;
+    PFN_vkDestroyDescriptorUpdateTemplateKHR vkDestroyDescriptorUpdateTemplateKHR = nullptr;
+    PFN_vkUpdateDescriptorSetWithTemplateKHR vkUpdateDescriptorSetWithTemplateKHR = nullptr;
     XrGraphicsBindingVulkanKHR graphicsBinding{};
 
     std::unordered_map<XrSwapchain, std::pair<SwapchainType, std::vector<XrSwapchainImageVulkanKHR>>> swapchainImagesMap{};
 
     VkImage currentDesktopSwapchainImage = VK_NULL_HANDLE;
+    VkImageLayout currentDesktopSwapchainImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
     std::unordered_map<VkSwapchainKHR, VkSurfaceKHR> surfaces;
     VkSemaphore acquireSemaphore{};
     VkSemaphore submitSemaphore{};
 
-    std::unordered_map<VkImage, VkImageLayout> imageStates;
-    std::unordered_map<VkImage, std::pair<VkDeviceMemory, ImageCreateInfo>> imageResources;
+    // Device memory is sub-allocated from large VkDeviceMemory blocks per memory type, rather than allocated per resource.
+    enum class MemoryStrategy : uint8_t {
+        FREE_LIST,  // First fit from the free ranges, which are merged again when freed.
+        LINEAR      // Bump allocation. The block is rewound once all of its allocations are freed.
+    };
+    struct MemoryAllocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mappedData = nullptr;
+    };
+    struct MemoryBlock {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t memoryTypeIndex = 0;
+        MemoryStrategy strategy = MemoryStrategy::FREE_LIST;
+        bool image = false;  // Images and buffers use separate blocks, so that bufferImageGranularity never applies.
+        bool dedicated = false;
+        void* mappedData = nullptr;
+        std::map<VkDeviceSize, VkDeviceSize> freeRanges;  // Offset to size.
+        VkDeviceSize linearOffset = 0;
+        uint32_t allocationCount = 0;
+        VkDeviceSize usedSize = 0;
+    };
+    std::vector<MemoryBlock> memoryBlocks;
+    static constexpr VkDeviceSize memoryBlockSize = 64 * 1024 * 1024;
+
+    std::unordered_map<VkImage, std::pair<MemoryAllocation, ImageCreateInfo>> imageResources;
     std::unordered_map<VkImageView, ImageViewCreateInfo> imageViewResources;
     
-    std::unordered_map<VkBuffer, std::pair<VkDeviceMemory, BufferCreateInfo>> bufferResources;
+    // Buffers and pipelines are looked up on every draw, so they're kept in SlotMaps.
+    struct BufferResource {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        MemoryAllocation allocation;
+        BufferCreateInfo bufferCI;
+    };
+    SlotMap<BufferResource, BufferTag> bufferResources;
 
     std::unordered_map<VkShaderModule, ShaderCreateInfo> shaderResources;
-    std::unordered_map<VkPipeline, std::tuple<VkPipelineLayout, VkDescriptorSetLayout, VkRenderPass, PipelineCreateInfo>> pipelineResources;
+    std::unordered_map<VkShaderModule, std::string> shaderKeys;
+
+    // Pipelines and the objects they're built from are shared between equivalent PipelineCreateInfos, and reference counted by their keys.
+    struct PipelineKeys {
+        std::string renderPass;
+        std::vector<std::string> descSetLayouts;  // One per descriptor set.
+        std::string pipelineLayout;
+        std::string pipeline;
+    };
+    // Each CreatePipeline() gets its own handle, even when the VkPipeline is shared.
+    struct PipelineResource {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        std::vector<VkDescriptorSetLayout> descSetLayouts;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        PipelineCreateInfo pipelineCI;
+        PipelineKeys keys;
+    };
+    SlotMap<PipelineResource, PipelineTag> pipelineResources;
+    std::unordered_map<std::string, std::pair<VkRenderPass, uint32_t>> sharedRenderPasses;
+    std::unordered_map<std::string, std::pair<VkDescriptorSetLayout, uint32_t>> sharedDescSetLayouts;
+    std::unordered_map<std::string, std::pair<VkPipelineLayout, uint32_t>> sharedPipelineLayouts;
+    // A pipeline is shared with everything that it was built from, so that each handle to it gets the same PipelineResource.
+    std::unordered_map<std::string, std::pair<PipelineResource, uint32_t>> sharedPipelines;
+
+    // Linear allocator for transient uniform data. Buffers are persistently mapped and the ring is rewound when its frame context is reused.
+    struct UniformBufferRing {
+        std::vector<BufferHandle> buffers;
+        size_t bufferIndex = 0;
+        size_t offset = 0;
+    };
+    static constexpr size_t uniformBufferRingBlockSize = 1024 * 1024;
+
+    // Objects that were destroyed while the GPU may still be using them. They're destroyed, and their memory is freed, once the GPU
+    // is done with the frame context that was current at the time. Until then, no other resource can be placed in their memory.
+    struct DeferredDestroys {
+        std::vector<VkFramebuffer> framebuffers;
+        std::vector<VkPipeline> pipelines;
+        std::vector<VkPipelineLayout> pipelineLayouts;
+        std::vector<VkDescriptorUpdateTemplateKHR> descUpdateTemplates;
+        std::vector<VkDescriptorSetLayout> descSetLayouts;
+        std::vector<VkRenderPass> renderPasses;
+        std::vector<VkImageView> imageViews;
+        std::vector<VkSampler> samplers;
+        std::vector<VkBuffer> buffers;
+        std::vector<VkImage> images;
+        std::vector<MemoryAllocation> memoryAllocations;
+    };
 
-    std::unordered_map<VkCommandBuffer, std::vector<VkFramebuffer>> cmdBufferFramebuffers;
+    // Everything that the GPU may still be using while the CPU records the next frame.
+    struct FrameContext {
+        VkCommandPool cmdPool{};
+        VkCommandBuffer cmdBuffer{};
+        VkFence fence{};
+        std::vector<VkDescriptorPool> descriptorPools;
+        size_t descriptorPoolIndex = 0;
+        std::unordered_map<std::string, VkDescriptorSet> descriptorSetCache;
+        bool resetDescriptorSetCache = false;
+        DeferredDestroys deferredDestroys;
+        UniformBufferRing uniformBufferRing;
+    };
+    std::vector<FrameContext> frameContexts;
+    uint32_t frameContextIndex = 0;
+    bool inFrame = false;
+    bool cmdBufferRecording = false;
+
+    // Framebuffers are cached by (render pass, attachments, width, height) and retired when one of them is destroyed.
+    std::map<std::tuple<VkRenderPass, std::vector<VkImageView>, uint32_t, uint32_t>, VkFramebuffer> framebufferCache;
     bool inRenderPass = false;
+    std::vector<VkImageView> renderPassAttachments;
+    VkRect2D renderPassRenderArea{};
+
+    // Render passes that only differ from the pipeline's one in their load/store operations, keyed by (pipeline's render pass, clear attachment mask, store depth).
+    std::map<std::tuple<VkRenderPass, uint32_t, bool>, VkRenderPass> renderPassVariants;
+    // Only a few image views are cleared per frame, so the pending clears are searched linearly.
+    struct PendingClear {
+        VkImageView imageView;
+        VkImageAspectFlags aspectMask;
+        VkClearValue clearValue;
+    };
+    std::vector<PendingClear> pendingClears;
+    bool storeDepthAttachment = true;
+
+    PipelineHandle setPipeline;
 
-    VkPipeline setPipeline = VK_NULL_HANDLE;
-    std::unordered_map<VkCommandBuffer, std::vector<VkDescriptorSet>> cmdBufferDescriptorSets;
-    std::vector<std::tuple<VkWriteDescriptorSet, VkDescriptorBufferInfo, VkDescriptorImageInfo>> writeDescSets;
+    // One entry per binding of a descriptor set layout. This is both the data for the layout's VkDescriptorUpdateTemplate and the key into the descriptor set cache.
+    struct DescriptorData {
+        VkDescriptorBufferInfo bufferInfo;
+        VkDescriptorImageInfo imageInfo;
+    };
+    std::unordered_map<VkDescriptorSetLayout, VkDescriptorUpdateTemplateKHR> descSetLayoutUpdateTemplates;
+    // The descriptors last set per set and binding. They're kept after UpdateDescriptors(), so that the sets can be bound again
+    // when a pipeline with a different layout disturbs them.
+    struct CurrentDescriptor {
+        uint32_t set;
+        uint32_t bindingIndex;
+        DescriptorData data;
+    };
+    std::vector<CurrentDescriptor> currentDescriptors;
+    uint32_t dirtySets = 0;  // Bit per set that SetDescriptor() was called for since the last UpdateDescriptors().
+    VkPipelineLayout boundPipelineLayout = VK_NULL_HANDLE;
+    std::vector<DescriptorData> descriptorData;
+    std::string descriptorSetKey;
+
+};
 
+template <>
+struct GraphicsAPI_Backend<VULKAN> {
+    typedef GraphicsAPI_Vulkan Type;
 };
 #endif
\ No newline at end of file
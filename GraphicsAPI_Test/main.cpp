@@ -38,13 +38,13 @@ static void WindowUpdate() {
 GraphicsAPI *graphicsAPI = nullptr;
 GraphicsAPI_Type apiType = D3D12;
 int64_t swapchainFormat = 0;
-void *vertexBuffer = nullptr;
-void *indexBuffer = nullptr;
-void *uniformBuffer_Vert = nullptr;
-void *uniformBuffer_Frag = nullptr;
+GraphicsAPI::BufferHandle vertexBuffer;
+GraphicsAPI::BufferHandle indexBuffer;
+GraphicsAPI::BufferHandle uniformBuffer_Vert;
+GraphicsAPI::BufferHandle uniformBuffer_Frag;
 
 void *vertexShader = nullptr, *fragmentShader = nullptr;
-void *pipeline = nullptr;
+GraphicsAPI::PipelineHandle pipeline;
 
 struct CameraConstants {
     XrMatrix4x4f viewProj;
@@ -177,8 +177,8 @@ void RenderCuboid(XrPosef pose, XrVector3f scale) {
     graphicsAPI->SetPipeline(pipeline);
 
     graphicsAPI->SetBufferData(uniformBuffer_Vert, 0, sizeof(CameraConstants), &cameraConstants);
-    graphicsAPI->SetDescriptor({1, uniformBuffer_Vert, GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::VERTEX, false});
-    graphicsAPI->SetDescriptor({0, uniformBuffer_Frag, GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::FRAGMENT, false});
+    graphicsAPI->SetDescriptor({1, uniformBuffer_Vert.ToPointer(), GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::VERTEX, false});
+    graphicsAPI->SetDescriptor({0, uniformBuffer_Frag.ToPointer(), GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::FRAGMENT, false});
     graphicsAPI->UpdateDescriptors();
 
     graphicsAPI->SetVertexBuffers(&vertexBuffer, 1);
@@ -237,7 +237,8 @@ int main() {
     } else if (apiType == D3D12) {
         graphicsAPI = new GraphicsAPI_D3D12();
     } else if (apiType == VULKAN) {
-        graphicsAPI = new GraphicsAPI_Vulkan();
+        // The uniform buffers are rewritten with SetBufferData() every frame, so only one frame can be in flight.
+        graphicsAPI = new GraphicsAPI_Vulkan(1);
     } else {
         return -1;
     }
@@ -349,18 +350,18 @@ int main() {
         30, 31, 32, 33, 34, 35,  // +Z
     };
 
-    void* vertexBuffer = graphicsAPI->CreateBuffer(
+    GraphicsAPI::BufferHandle vertexBuffer = graphicsAPI->CreateBuffer(
         {GraphicsAPI::BufferCreateInfo::Type::VERTEX, sizeof(float) * 4, sizeof(cubeVertices),
          &cubeVertices});
 
-    void* indexBuffer = graphicsAPI->CreateBuffer(
+    GraphicsAPI::BufferHandle indexBuffer = graphicsAPI->CreateBuffer(
         {GraphicsAPI::BufferCreateInfo::Type::INDEX, sizeof(uint32_t), sizeof(cubeIndices),
          &cubeIndices});
 
-    void* uniformBuffer_Frag = graphicsAPI->CreateBuffer(
+    GraphicsAPI::BufferHandle uniformBuffer_Frag = graphicsAPI->CreateBuffer(
         {GraphicsAPI::BufferCreateInfo::Type::UNIFORM, 0, sizeof(colors), colors});
 
-    void* uniformBuffer_Vert = graphicsAPI->CreateBuffer(
+    GraphicsAPI::BufferHandle uniformBuffer_Vert = graphicsAPI->CreateBuffer(
         {GraphicsAPI::BufferCreateInfo::Type::UNIFORM, 0, sizeof(CameraConstants), &cameraConstants});
 
     void *vertexShader = nullptr;
@@ -406,7 +407,7 @@ int main() {
     pipelineCI.colorFormats = {swapchainFormat};
     pipelineCI.depthFormat = graphicsAPI->GetDepthFormat();
     pipelineCI.layout = {{1, nullptr, GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::VERTEX, false}, {0, nullptr, GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::FRAGMENT, false}};
-    void* pipeline = graphicsAPI->CreatePipeline(pipelineCI);
+    GraphicsAPI::PipelineHandle pipeline = graphicsAPI->CreatePipeline(pipelineCI);
 
     // Main Render Loop
     while (!g_WindowQuit) {
@@ -452,9 +453,9 @@ int main() {
         graphicsAPI->SetPipeline(pipeline);
 
         graphicsAPI->SetBufferData(uniformBuffer_Vert, 0, sizeof(CameraConstants), &cameraConstants);
-        graphicsAPI->SetDescriptor({1, uniformBuffer_Vert, GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::VERTEX, false});
+        graphicsAPI->SetDescriptor({1, uniformBuffer_Vert.ToPointer(), GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::VERTEX, false});
         graphicsAPI->SetBufferData(uniformBuffer_Frag, 0, sizeof(colors), (void*)colors);
-        graphicsAPI->SetDescriptor({0, uniformBuffer_Frag, GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::FRAGMENT, false});
+        graphicsAPI->SetDescriptor({0, uniformBuffer_Frag.ToPointer(), GraphicsAPI::DescriptorInfo::Type::BUFFER, GraphicsAPI::DescriptorInfo::Stage::FRAGMENT, false});
         graphicsAPI->UpdateDescriptors();
 
         graphicsAPI->SetVertexBuffers(&vertexBuffer, 1);
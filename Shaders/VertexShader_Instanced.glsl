@@ -0,0 +1,33 @@
+// Copyright 2023, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#version 450
+#extension GL_KHR_vulkan_glsl : enable
+// OpenGL has no push constants, so GraphicsAPI_OpenGL streams them into a uniform block at binding 13.
+#ifdef VULKAN
+layout(push_constant) uniform PushConstants {
+    mat4 viewProj;
+} pushConstants;
+#else
+layout(std140, binding = 13) uniform PushConstants {
+    mat4 viewProj;
+} pushConstants;
+#endif
+layout(std140, binding = 1) uniform Normals {
+    vec4 normals[6];
+};
+layout(location = 0) in vec4 a_Positions;
+// Per-instance: the model matrix takes locations 1 to 4.
+layout(location = 1) in mat4 i_Model;
+layout(location = 5) in vec4 i_Color;
+layout(location = 0) out flat uvec2 o_TexCoord;
+layout(location = 1) out flat vec3 o_Normal;
+layout(location = 2) out flat vec3 o_Color;
+void main() {
+    gl_Position = pushConstants.viewProj * i_Model * a_Positions;
+    int face = gl_VertexIndex / 6;
+    o_TexCoord = uvec2(face, 0);
+    o_Normal = (i_Model * normals[face]).xyz;
+    o_Color = i_Color.rgb;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+// Copyright 2023, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Push constants: root constants in D3D12, and a constant buffer that GraphicsAPI_D3D11 rewrites per draw in D3D11.
+cbuffer PushConstants : register(b13)
+{
+    float4x4 viewProj;
+};
+cbuffer Normals : register(b1)
+{
+    float4 normals[6];
+};
+
+struct VS_IN
+{
+    uint vertexId : SV_VertexId;
+    float4 a_Positions : TEXCOORD0;
+    // Per-instance: the columns of the model matrix, and the color.
+    float4 i_Model0 : TEXCOORD1;
+    float4 i_Model1 : TEXCOORD2;
+    float4 i_Model2 : TEXCOORD3;
+    float4 i_Model3 : TEXCOORD4;
+    float4 i_Color : TEXCOORD5;
+};
+struct VS_OUT
+{
+    float4 o_Position : SV_Position;
+    nointerpolation float2 o_TexCoord : TEXCOORD0;
+    float3 o_Normal : TEXCOORD1;
+    nointerpolation float3 o_Color : TEXCOORD2;
+};
+
+VS_OUT main(VS_IN IN)
+{
+    VS_OUT OUT;
+    float4x4 instanceModel = transpose(float4x4(IN.i_Model0, IN.i_Model1, IN.i_Model2, IN.i_Model3));
+    OUT.o_Position = mul(viewProj, mul(instanceModel, IN.a_Positions));
+    int face = IN.vertexId / 6;
+    OUT.o_TexCoord = float2(float(face), 0);
+    OUT.o_Normal = (mul(instanceModel, normals[face])).xyz;
+    OUT.o_Color = IN.i_Color.rgb;
+    return OUT;
+}
\ No newline at end of file
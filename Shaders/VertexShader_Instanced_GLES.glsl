@@ -0,0 +1,26 @@
+// Copyright 2023, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#version 310 es
+// Push constants, which GraphicsAPI_OpenGL_ES emulates with a uniform block at binding 13.
+layout(std140, binding = 13) uniform PushConstants {
+    mat4 viewProj;
+} pushConstants;
+layout(std140, binding = 1) uniform Normals {
+    vec4 normals[6];
+};
+layout(location = 0) in highp vec4 a_Positions;
+// Per-instance: the model matrix takes locations 1 to 4.
+layout(location = 1) in highp mat4 i_Model;
+layout(location = 5) in highp vec4 i_Colour;
+layout(location = 0) out flat uvec2 o_TexCoord;
+layout(location = 1) out highp vec3 o_Normal;
+layout(location = 2) out flat vec3 o_Colour;
+void main() {
+    gl_Position = pushConstants.viewProj * i_Model * a_Positions;
+    int face = gl_VertexID / 6;
+    o_TexCoord = uvec2(face, 0);
+    o_Normal = (i_Model * normals[face]).xyz;
+    o_Colour = i_Colour.rgb;
+}
\ No newline at end of file
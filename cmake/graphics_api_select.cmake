@@ -7,6 +7,9 @@ include_guard()
 
 set(XR_TUTORIAL_GRAPHICS_API "VULKAN" CACHE STRING "Which graphics API to use when building the tutorial projects.")
 
+option(XR_TUTORIAL_OPENGL_EGL "Create the OpenGL context through EGL when no display server is available (Linux only)." OFF)
+option(XR_TUTORIAL_OPENGL_ES_DESKTOP "Build the OpenGL ES backend instead of OpenGL, using an EGL context (Linux only). Use with XR_TUTORIAL_GRAPHICS_API=OPENGL_ES." OFF)
+
 IF(DEFINED ENV{GFX})
     message(STATUS, "Overriding graphics api: " $ENV{GFX} )
     set_property(CACHE XR_TUTORIAL_GRAPHICS_API PROPERTY VALUE $ENV{GFX})